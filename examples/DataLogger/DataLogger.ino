@@ -9,7 +9,14 @@ struct SensorData {
     uint32_t timestamp;
 };
 
-MemoryList dataLogger("/sensor_log.txt");
+// Save the list's state on sync(), so a reboot after it starts logging without scanning the file
+MemoryListConfig loggerConfig() {
+    MemoryListConfig config;
+    config.persistState = true;
+    return config;
+}
+
+MemoryList dataLogger("/sensor_log.txt", loggerConfig());
 const uint32_t LOG_INTERVAL = 5000;  // Log every 5 seconds
 uint32_t lastLog = 0;
 int logCount = 0;
@@ -73,6 +80,7 @@ void loop() {
             Serial.printf("File Size: %d bytes\n", stats["fileSize"].as<int>());
             Serial.printf("Fragmentation: %.2f%%\n", 
                 stats["fragmentation"].as<float>() * 100);
+            dataLogger.sync();
         }
         
         lastLog = millis();
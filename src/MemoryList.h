@@ -14,10 +14,256 @@
 #include <StreamUtils.h>
 #include <ArduinoJson.h>
 #include <Tester.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <mutex>
+#include <shared_mutex>
+#include <type_traits>
 
 
 /**
- * @class MemoryList
+ * @brief Compile-time switch for the I/O counters reported by getStats()
+ * @details Define MEMORY_LIST_IO_STATS to count opens, seeks, bytes and flushes on the
+ *          hot paths. Without it the counting statements expand to nothing.
+ */
+#ifdef MEMORY_LIST_IO_STATS
+#define MEMORY_LIST_IO(counter, amount) (ioStats.counter += (amount))
+#define MEMORY_LIST_IO_MAX(counter, value) (ioStats.counter = max<size_t>(ioStats.counter, (value)))
+#else
+#define MEMORY_LIST_IO(counter, amount) ((void)0)
+#define MEMORY_LIST_IO_MAX(counter, value) ((void)0)
+#endif
+
+
+/**
+ * @brief On-disk layout of the records of a list
+ */
+enum class RecordFormat : uint8_t {
+    /** @brief One JSON document per line, terminated by "\r\n"; the original format */
+    Text,
+    /** @brief Each payload preceded by a header holding flags, payload length and CRC-32 */
+    Binary
+};
+
+
+/**
+ * @brief Encoding of the JSON payload of a record
+ */
+enum class RecordEncoding : uint8_t {
+    /** @brief JSON text, as serializeJson() writes it */
+    Json,
+    /** @brief MessagePack, as serializeMsgPack() writes it; smaller and quicker to parse, binary records only */
+    MessagePack
+};
+
+
+/**
+ * @struct MemoryListConfig
+ * @brief Optional features of a MemoryList
+ * @details The defaults keep the original behaviour, so a list constructed with only a path
+ *          behaves exactly like the plain newline-delimited file it always was.
+ */
+struct MemoryListConfig {
+    /** @brief Keep a sidecar file (filePath + ".idx") with the byte offset of every live record */
+    bool useIndex = false;
+    /** @brief Live records between the RAM checkpoints reads start from, e.g. 256; 0 keeps none unless checkpointBudget */
+    size_t checkpointInterval = 0;
+    /** @brief RAM the checkpoint table may take in bytes; when full the interval doubles, so it covers any list size */
+    size_t checkpointBudget = 0;
+    /** @brief Hold one read/write handle on the data file (and index) for the list's lifetime */
+    bool keepOpen = false;
+    /** @brief Persist the counters, head and tail (filePath + ".meta") so a cleanly closed list reopens without a scan */
+    bool persistState = false;
+    /** @brief Size of the buffer push() serializes through; 0 streams straight into the file */
+    size_t writeBufferSize = 64;
+    /** @brief RAM push() collects records in before writing them, rounded up to whole sectors; 0 writes every push() */
+    size_t writeBackSize = 0;
+    /** @brief Milliseconds a record may wait in the write-back buffer, 0 to wait until it fills */
+    uint32_t writeBackTimeout = 1000;
+    /** @brief Let remove() and removeFirst() run defragment() when due; turn off to compact with defragmentStep() */
+    bool autoDefragment = true;
+    /** @brief Compact on a low-priority task of the list's own instead of in remove() and removeFirst() */
+    bool backgroundCompaction = false;
+    /** @brief Core the list's task (background compaction, ingest draining) is pinned to */
+    int taskCore = 0;
+    /** @brief Data file bytes the compaction task copies per defragmentStep() */
+    size_t compactionStepBytes = 4096;
+    /** @brief Slots of the lock-free ingest ring behind enqueue(), rounded up to a power of two; 0 disables it */
+    size_t ingestSlots = 0;
+    /** @brief Bytes per ingest slot, the serialized record without framing, at most 503; longer records count as overflows */
+    size_t ingestSlotSize = 128;
+    /** @brief Queued records that wake the list's task to drain the ring into the file, at most the ring's capacity; 0 drains only on flush() */
+    size_t ingestHighWatermark = 48;
+    /** @brief Records the task leaves queued when it drains, 0 to drain everything; kept below the high watermark */
+    size_t ingestLowWatermark = 0;
+    /** @brief Record layout of a new or emptied data file; a file holding records keeps the layout it has */
+    RecordFormat format = RecordFormat::Text;
+    /** @brief Payload encoding of new records; MessagePack makes a new or emptied file binary, a text file keeps JSON */
+    RecordEncoding encoding = RecordEncoding::Json;
+};
+
+
+/**
+ * @class IngestRing
+ * @brief Bounded lock-free queue of serialized records, many producers and one consumer
+ * @details Each cell carries a sequence number that says whose turn it is: a producer claims
+ *          a cell with one compare-and-swap on the enqueue position, fills it and publishes it
+ *          by advancing the sequence; the consumer reads published cells in order and hands
+ *          them back the same way. Nothing ever waits, so enqueueing is safe from any task.
+ *          A full ring rejects the record instead of blocking.
+ */
+class IngestRing {
+public:
+    IngestRing() = default;
+    IngestRing(const IngestRing&) = delete;
+    IngestRing& operator=(const IngestRing&) = delete;
+
+    ~IngestRing() {
+        free(cells);
+        free(storage);
+    }
+
+    /**
+     * @brief Allocates the ring
+     * @param slots Number of records it holds, rounded up to a power of two
+     * @param slotSize Longest record it holds in bytes
+     * @return true if successful, false if the allocation failed
+     */
+    bool begin(const size_t slots, const size_t slotSize) {
+        size_t capacity = 1;
+        while (capacity < slots) capacity <<= 1;
+        cells = static_cast<Cell*>(malloc(capacity * sizeof(Cell)));
+        storage = static_cast<char*>(malloc(capacity * slotSize));
+        if (!cells || !storage) {free(cells); free(storage); cells = nullptr; storage = nullptr; return false;}
+        for (size_t i = 0; i < capacity; i++) {
+            new (&cells[i]) Cell();
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        mask = capacity - 1;
+        width = slotSize;
+        return true;
+    }
+
+    /**
+     * @brief Claims a cell, lets write() fill it and publishes it
+     * @param length Bytes write() will store, at most slotSize()
+     * @param write Callable receiving the cell's buffer
+     * @return true if queued, false if the ring is full or the record does not fit
+     */
+    template <typename Writer>
+    bool emplace(const size_t length, Writer&& write) {
+        if (!cells || length > width) return false;
+        size_t position = enqueuePos.load(std::memory_order_relaxed);
+        Cell* cell = nullptr;
+        for (;;) {
+            cell = &cells[position & mask];
+            const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const auto lag = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            if (lag == 0) {
+                if (enqueuePos.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+            } else if (lag < 0) {
+                return false;
+            } else {
+                position = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        write(storage + (position & mask) * width);
+        cell->length = length;
+        cell->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Oldest published record, consumer only
+     * @param length Set to the record's length
+     * @return The record, nullptr if there is none yet
+     */
+    [[nodiscard]] const char* front(size_t& length) const {
+        if (!cells) return nullptr;
+        const size_t position = dequeuePos.load(std::memory_order_relaxed);
+        const Cell& cell = cells[position & mask];
+        if (cell.sequence.load(std::memory_order_acquire) != position + 1) return nullptr;
+        length = cell.length;
+        return storage + (position & mask) * width;
+    }
+
+    /**
+     * @brief Hands the record returned by front() back to the producers, consumer only
+     */
+    void pop() {
+        const size_t position = dequeuePos.load(std::memory_order_relaxed);
+        cells[position & mask].sequence.store(position + mask + 1, std::memory_order_release);
+        dequeuePos.store(position + 1, std::memory_order_release);
+    }
+
+    /** @brief Records claimed and not yet popped, including ones still being written */
+    [[nodiscard]] size_t size() const {
+        return enqueuePos.load(std::memory_order_relaxed) - dequeuePos.load(std::memory_order_acquire);
+    }
+
+    /** @brief Whether begin() succeeded */
+    [[nodiscard]] bool enabled() const {return cells != nullptr;}
+
+    /** @brief Records the ring holds, 0 before begin() */
+    [[nodiscard]] size_t capacity() const {return cells ? mask + 1 : 0;}
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence{0};
+        size_t length = 0;
+    };
+
+    Cell* cells = nullptr;
+    char* storage = nullptr;
+    size_t mask = 0;
+    size_t width = 0;
+    std::atomic<size_t> enqueuePos{0};
+    std::atomic<size_t> dequeuePos{0};
+};
+
+
+/**
+ * @brief Lock policy that does no locking, for lists used from a single task
+ */
+struct NoLock {
+    void lock() {}
+    void unlock() {}
+    void lock_shared() {}
+    void unlock_shared() {}
+};
+
+
+/**
+ * @brief Lock policy that serializes every operation
+ */
+struct MutexLock {
+    std::mutex mutex;
+
+    void lock() {mutex.lock();}
+    void unlock() {mutex.unlock();}
+    void lock_shared() {mutex.lock();}
+    void unlock_shared() {mutex.unlock();}
+};
+
+
+/**
+ * @brief Lock policy that lets readers run in parallel while writers serialize
+ */
+struct ReadWriteLock {
+    std::shared_mutex mutex;
+
+    void lock() {mutex.lock();}
+    void unlock() {mutex.unlock();}
+    void lock_shared() {mutex.lock_shared();}
+    void unlock_shared() {mutex.unlock_shared();}
+};
+
+
+/**
+ * @class BasicMemoryList
  * @brief SD card-based FIFO list manager for JSON objects
  * @details Implements a FIFO list stored on SD card with features including:
  *          - JSON object storage and retrieval
@@ -25,112 +271,2539 @@
  *          - Tombstone-based deletion system
  *          - Buffer-aware operations for ESP32
  *          - Memory-efficient streaming operations
+ * @tparam Lock Lock policy guarding every public method: NoLock (default, see MemoryList),
+ *         MutexLock or ReadWriteLock. Const methods take it shared, the others exclusively.
  */
+template <typename Lock = NoLock>
+class BasicMemoryList {
+private:
+    /** @brief Path to the storage file on SD card */
+    String filePath;
+
+    /** @brief Optional features selected at construction */
+    MemoryListConfig config;
+
+    /** @brief Current number of valid entries in the list */
+    size_t currentSize = 0;
+    /** @brief Bytes occupied by live records, including their line endings */
+    size_t liveBytes = 0;
+    /** @brief Bytes occupied by tombstoned records */
+    size_t deadBytes = 0;
+    /** @brief Byte offset at or before the first live record; everything before it is tombstoned */
+    size_t headOffset = 0;
+    /** @brief Byte offset of the last live record, valid while tailKnown is set */
+    mutable std::atomic<size_t> tailOffset{0};
+    /** @brief Raw length of the last live record, line ending included */
+    mutable std::atomic<size_t> tailLength{0};
+    /** @brief Whether tailOffset/tailLength describe the current last record */
+    mutable std::atomic<bool> tailKnown{false};
+    /** @brief Upper bound on the raw length of any live record, line ending included */
+    size_t maxRecordLength = 0;
+    /** @brief Whether the data file holds binary records, see RecordFormat */
+    bool binaryRecords = false;
+
+    /** @brief Buffer size optimized for ESP32 SD card operations */
+    static constexpr size_t BUFFER_SIZE = 512;  // ESP32 friendly buffer size
+    /** @brief SD card sector size, the unit the write-back buffer is allocated in */
+    static constexpr size_t SECTOR_SIZE = 512;
+    /** @brief Read size of the one-time construction scan, allocated only for its duration */
+    static constexpr size_t SCAN_BUFFER_SIZE = 8192;
+    /** @brief Character used to mark deleted entries */
+    static constexpr char TOMBSTONE = '$';      // Marker for deleted entries
+    /** @brief High nibble of the first byte of a live binary record, the low nibble holds its flags */
+    static constexpr uint8_t RECORD_LIVE = 0xB0;
+    /** @brief First byte of a removed binary record; never starts a text line, which tells the formats apart */
+    static constexpr uint8_t RECORD_DEAD = 0xA0;
+    /** @brief Flag of a live binary record whose payload is MessagePack rather than JSON text */
+    static constexpr uint8_t RECORD_MSGPACK = 0x01;
+    /** @brief Bytes ahead of a binary record's payload: flags, payload length and CRC-32 */
+    static constexpr size_t RECORD_HEADER_SIZE = 9;
+    /** @brief Threshold ratio that triggers automatic defragmentation */
+    static constexpr float DEFRAG_THRESHOLD = 0.6f; // 60% fragmentation triggers defrag
+    /** @brief Open mode for in-place writes (FILE_WRITE truncates on ESP32) */
+    static constexpr const char* FILE_READ_WRITE = "r+";
+    /** @brief Magic number identifying an index file ("MLIX") */
+    static constexpr uint32_t INDEX_MAGIC = 0x58494C4D;
+    /** @brief Magic number identifying a metadata file ("MLMT") */
+    static constexpr uint32_t META_MAGIC = 0x544D4C4D;
+    /** @brief Stack of the list's task in bytes, room for defragmentStep() and its index rebuild */
+    static constexpr uint32_t WORKER_STACK_SIZE = 8192;
+    /** @brief Priority of the list's task, just above idle */
+    static constexpr UBaseType_t WORKER_PRIORITY = tskIDLE_PRIORITY + 1;
+    /** @brief Notification bit asking the list's task to run the compaction begun for it */
+    static constexpr uint32_t WORKER_COMPACT = 1;
+    /** @brief Notification bit asking the list's task to exit */
+    static constexpr uint32_t WORKER_STOP = 2;
+    /** @brief Notification bit asking the list's task to drain the ingest ring */
+    static constexpr uint32_t WORKER_DRAIN = 4;
+
+
+    /**
+     * @brief Header of a binary record
+     * @details Stored as 9 bytes: flags, then the payload length and the CRC-32 of the payload,
+     *          both little-endian. Removing the record overwrites the flags with RECORD_DEAD.
+     */
+    struct RecordHeader {
+        uint8_t flags = RECORD_LIVE;
+        uint32_t length = 0;
+        uint32_t checksum = 0;
+    };
+
+
+    /**
+     * @brief Print sink that only measures and checksums what is written to it
+     * @details Lets writeRecord() fill in a binary header before it streams the payload
+     */
+    class ChecksumPrint : public Print {
+    public:
+        using Print::write;
+        size_t write(const uint8_t c) override {return write(&c, 1);}
+        size_t write(const uint8_t* buffer, const size_t size) override {
+            checksum = crc32(buffer, size, checksum);
+            length += size;
+            return size;
+        }
+
+        uint32_t checksum = 0;
+        size_t length = 0;
+    };
+
+
+    /**
+     * @brief On-disk header of the offset index
+     * @details Followed by `count` uint32_t record offsets. Entries [first, count) are the
+     *          live records in list order; dataSize ties the index to the data file it describes.
+     */
+    struct IndexHeader {
+        uint32_t magic = INDEX_MAGIC;
+        uint32_t dataSize = 0;
+        uint32_t first = 0;
+        uint32_t count = 0;
+    };
+
+    /** @brief Cached copy of the index header, only meaningful when config.useIndex is set */
+    IndexHeader indexHeader;
+
+    /**
+     * @brief On-disk content of the metadata file
+     * @details A snapshot of the derived state, protected by a CRC-32 over the preceding
+     *          fields. Only a clean record whose dataSize matches the data file replaces the
+     *          construction scan; the head of any intact record still bounds where the scan starts.
+     */
+    struct MetaRecord {
+        uint32_t magic = META_MAGIC;
+        uint32_t clean = 0;
+        uint32_t dataSize = 0;
+        uint32_t count = 0;
+        uint32_t liveBytes = 0;
+        uint32_t deadBytes = 0;
+        uint32_t headOffset = 0;
+        uint32_t tailOffset = 0;
+        uint32_t tailLength = 0;  // 0 when the tail is unknown
+        uint32_t maxRecordLength = 0;
+        uint32_t checksum = 0;
+    };
+
+    /** @brief Whether the metadata file currently claims to describe the data file */
+    bool stateClean = false;
+
+    /** @brief Data file handle held open in session mode, closed otherwise */
+    mutable File sessionData;
+    /** @brief Index file handle held open in session mode, closed otherwise */
+    mutable File sessionIndex;
+    /** @brief Metadata file handle held open in session mode, closed otherwise */
+    mutable File sessionMeta;
+
+#ifdef MEMORY_LIST_IO_STATS
+    /**
+     * @brief Card traffic since construction, see MEMORY_LIST_IO_STATS
+     * @details Flushes count explicit flush() calls only; closing a written file flushes it as well.
+     */
+    struct IoStats {
+        std::atomic<uint32_t> opens{0};
+        std::atomic<uint32_t> seeks{0};
+        std::atomic<size_t> bytesRead{0};
+        std::atomic<size_t> bytesWritten{0};
+        std::atomic<uint32_t> flushes{0};
+        std::atomic<uint32_t> defragmentRuns{0};
+        std::atomic<unsigned long> defragmentMicros{0};
+        std::atomic<size_t> largestRecord{0};
+    };
+
+    /** @brief Counters updated through MEMORY_LIST_IO, mutable and atomic as shared readers count too */
+    mutable IoStats ioStats;
+#endif
+
+    /**
+     * @brief Progress of an incremental defragmentation driven by defragmentStep()
+     * @details The live records of the data file before `source`, which is always a record start,
+     *          have been appended to the temp file in list order, so the first `copied` records of
+     *          the list live there as well.
+     */
+    struct Compaction {
+        bool active = false;
+        size_t source = 0;       // next data file byte to copy
+        size_t size = 0;         // bytes in the temp file
+        size_t deadBytes = 0;    // temp file bytes tombstoned after being copied
+        size_t head = 0;         // at or before the first live line of the temp file
+        size_t copied = 0;       // records in the temp file that are still live
+        size_t longest = 0;      // longest record copied, line ending included
+        size_t tailOffset = 0;   // temp file offset of the last record copied
+        size_t tailLength = 0;   // its raw length, 0 once it is removed
+    };
+
+    /** @brief State of the compaction in progress, inactive when none is */
+    Compaction compaction;
+
+    /** @brief Lock of the lock policy, taken by every public method */
+    mutable Lock lock;
+    /** @brief Serializes the list's task with the application when the policy is NoLock */
+    mutable std::mutex workerLock;
+    /** @brief The list's task, nullptr unless background compaction or the ingest ring needs it */
+    TaskHandle_t workerTask = nullptr;
+    /** @brief Set by the list's task as the last thing it does */
+    std::atomic<bool> workerExited{false};
+
+    /** @brief Records queued by enqueue(), disabled unless config.ingestSlots */
+    IngestRing ingest;
+    /** @brief Records lost on the way into the file: ring full, record too long or write failed */
+    std::atomic<uint32_t> ingestOverflows{0};
+
+    /**
+     * @brief Records push() has accepted but not yet written, see config.writeBackSize
+     * @details Framed like the file's records, so the buffer is written out as one chunk.
+     *          The counters and the index cover only what is in the file; size() adds `records`.
+     */
+    struct WriteBack {
+        char* buffer = nullptr;
+        size_t capacity = 0;      // 0 when write-back is off
+        size_t used = 0;
+        size_t records = 0;
+        size_t lastLength = 0;    // raw length of the last record buffered
+        unsigned long since = 0;  // millis() when the oldest buffered record was pushed
+    };
+
+    /** @brief The write-back buffer, empty unless config.writeBackSize */
+    WriteBack writeBack;
+
+    /**
+     * @brief Position in the data file a read can start from instead of the head
+     * @details The record at `offset` is the live record `index` or a removed one before it, with
+     *          no live record in between, so a scan from there skips exactly `index` live records
+     *          fewer than one from the head. Removals therefore leave the offset alone.
+     */
+    struct Checkpoint {
+        uint32_t index = 0;   // index in the list of the first live record at or after offset
+        uint32_t offset = 0;  // byte offset of a record in the data file
+        uint32_t moved = 0;   // the record's offset in the temp file, once a compaction has copied it
+    };
+
+    /** @brief Checkpoints in index order, about every checkpointStride records; none with the index */
+    Checkpoint* checkpoints = nullptr;
+    /** @brief Checkpoints in use */
+    size_t checkpointCount = 0;
+    /** @brief Checkpoints allocated, fixed by config.checkpointBudget when one is set */
+    size_t checkpointCapacity = 0;
+    /** @brief Live records between checkpoints, config.checkpointInterval doubled as the budget requires */
+    size_t checkpointStride = 0;
+
+
+    /**
+     * @brief Holds the policy lock for the duration of one public operation
+     * @details Readers take it shared unless the session handles are in use, as those share
+     *          one file position. With NoLock and the list's task running, workerLock is
+     *          taken as well, so the task and the application still exclude each other.
+     */
+    class Guard {
+    public:
+        Guard(const BasicMemoryList& list, const bool shared) :
+            list(list),
+            shared(shared && !list.config.keepOpen),
+            fallback(std::is_same_v<Lock, NoLock> && list.usesWorker())
+        {
+            if (this->shared) list.lock.lock_shared();
+            else list.lock.lock();
+            if (fallback) list.workerLock.lock();
+        }
+
+        ~Guard() {
+            if (fallback) list.workerLock.unlock();
+            if (shared) list.lock.unlock_shared();
+            else list.lock.unlock();
+        }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+    private:
+        const BasicMemoryList& list;
+        const bool shared;
+        const bool fallback;
+    };
+
+    /** @brief Locks the list for an operation that only reads it */
+    [[nodiscard]] Guard readGuard() const {return Guard(*this, true);}
+
+    /** @brief Locks the list for an operation that changes it */
+    [[nodiscard]] Guard writeGuard() const {return Guard(*this, false);}
+
+
+    /** @brief Whether the configuration asks for the list's task */
+    [[nodiscard]] bool usesWorker() const {
+        return config.backgroundCompaction || config.ingestSlots > 0 || (config.writeBackSize > 0 && config.writeBackTimeout > 0);
+    }
+
+
+    /**
+     * @brief Body of the list's task
+     * @param self The BasicMemoryList that owns the task
+     * @details Sleeps until notified. Drains the ingest ring down to the low watermark when
+     *          asked, and runs compaction steps under the lock until the compaction begun by
+     *          defragmentIfDue() is done, leaving the lock to the application for a tick
+     *          between steps. With a write-back timeout it also wakes every timeout period
+     *          to write out records that have waited that long. It exits only once it has
+     *          received WORKER_STOP, so the owner never notifies a deleted task.
+     */
+    static void workerLoop(void* self) {
+        auto* list = static_cast<BasicMemoryList*>(self);
+        const TickType_t idle = list->config.writeBackSize && list->config.writeBackTimeout ?
+                                pdMS_TO_TICKS(list->config.writeBackTimeout) : portMAX_DELAY;
+        bool more = false;
+        for (;;) {
+            uint32_t bits = 0;
+            xTaskNotifyWait(0, UINT32_MAX, &bits, more ? 1 : idle);
+            if (bits & WORKER_STOP) break;
+
+            const Guard guard = list->writeGuard();
+            if (bits & WORKER_DRAIN) list->drainIngest(list->config.ingestLowWatermark);
+            if (list->writeBackDue()) list->flushWriteBack();
+            more = list->config.backgroundCompaction && list->compaction.active &&
+                   list->compactStep(list->config.compactionStepBytes, 0);
+        }
+        list->workerExited = true;
+        vTaskDelete(nullptr);
+    }
+
+
+    /**
+     * @brief Starts the list's task
+     * @return true if the task was created
+     */
+    bool startWorker() {
+        workerExited = false;
+        TaskHandle_t task = nullptr;
+        if (xTaskCreatePinnedToCore(workerLoop, "MemoryList", WORKER_STACK_SIZE, this,
+                                    WORKER_PRIORITY, &task, config.taskCore) != pdPASS) return false;
+        workerTask = task;
+        return true;
+    }
+
+
+    /**
+     * @brief Stops the list's task and waits for it to exit
+     * @details A step in progress completes first; a compaction left unfinished is dropped
+     *          with the list, and its temp file is overwritten by the next one.
+     */
+    void stopWorker() {
+        if (!workerTask) return;
+        xTaskNotify(workerTask, WORKER_STOP, eSetBits);
+        while (!workerExited) vTaskDelay(1);
+        workerTask = nullptr;
+    }
+
+
+    /**
+     * @brief Compacts once the dead bytes pass the threshold
+     * @details With the compaction task, begins an incremental compaction and wakes the task
+     *          to run it, so later pushes lowering the ratio cannot cancel it. Otherwise compacts
+     *          the whole file here when config.autoDefragment allows it.
+     */
+    void defragmentIfDue() {
+        if (!defragmentDue()) return;
+        if (config.backgroundCompaction) {
+            if (compaction.active || beginCompaction()) xTaskNotify(workerTask, WORKER_COMPACT, eSetBits);
+        }
+        else if (config.autoDefragment) compactAll();
+    }
+
+
+    /**
+     * @brief Serializes a JSON object straight into the file as one record
+     * @param element JSON object to store
+     * @param file Open file handle, writes go to its end
+     * @return Number of bytes written, line ending or header included, 0 on failure
+     * @details No String is built: the JSON goes through a config.writeBufferSize
+     *          WriteBufferingStream, or directly into the file when that size is 0, so a
+     *          record of any size costs at most that one buffer. A binary header is found with
+     *          a first serialization pass into a ChecksumPrint. The file size is checked
+     *          afterwards because the buffered writes only report what was accepted.
+     */
+    size_t writeRecord(const JsonObjectConst element, File& file) const {
+        const size_t start = sizeOf(file);
+        size_t written = 0;
+        if (binaryRecords) {
+            ChecksumPrint payload;
+            serializePayload(element, payload);
+            RecordHeader header;
+            header.flags = packRecords() ? RECORD_LIVE | RECORD_MSGPACK : RECORD_LIVE;
+            header.length = payload.length;
+            header.checksum = payload.checksum;
+            uint8_t bytes[RECORD_HEADER_SIZE];
+            encodeHeader(header, bytes);
+            written = file.write(bytes, RECORD_HEADER_SIZE);
+        }
+        if (config.writeBufferSize > 0) {
+            // The destructor drains the buffer without flush(), which would fsync the file on ESP32
+            WriteBufferingStream writer(file, config.writeBufferSize);
+            written += serializePayload(element, writer);
+            if (!binaryRecords) written += writer.println();
+        } else {
+            written += serializePayload(element, file);
+            if (!binaryRecords) written += file.println();
+        }
+        MEMORY_LIST_IO(bytesWritten, written);
+        if (written == 0 || sizeOf(file) != start + written) {DEBUG_PRINT("Failed to write element to file!"); return 0;}
+        MEMORY_LIST_IO_MAX(largestRecord, written);
+        return written;
+    }
+
+
+    /**
+     * @brief Internal method to push JSON object to file
+     * @param element JSON object to store
+     * @param file Open file handle
+     * @return Number of bytes written, 0 on failure
+     * @details Handles serialization and writing of JSON objects with error checking
+     */
+    size_t push(const JsonObjectConst element, File file) {
+        if (!file) {DEBUG_PRINT("File not opened by SD!");return 0;}
+        if (element.isNull()) {DEBUG_PRINT("Element is null!");return 0;}
+
+        const size_t written = writeRecord(element, file);
+        if (written) {currentSize++; liveBytes += written;}
+        return written;
+    }
+
+
+    /**
+     * @brief Validates and ensures file existence
+     * @return true if file exists or was created successfully
+     * @details Creates file if it doesn't exist, performs error checking
+     */
+    [[nodiscard]] bool checkFile() const {
+        if (!SD.exists(filePath)) {
+            File dataFile = SD.open(filePath, FILE_WRITE);
+            if (!dataFile) {DEBUG_PRINT("Failed to create file!"); return false;}
+            dataFile.close();
+        }
+        return true;
+    }
+
+
+    /**
+     * @brief Reads a line from specific position in file
+     * @param cursor_pos Starting position in file
+     * @param file Open file handle
+     * @param lineLength Optional pointer to store the raw line length, newline included
+     * @return String containing the line read, or a binary record's payload as JSON once its checksum matches
+     * @details Handles boundary conditions and EOF. Reads in BUFFER_SIZE chunks, so a
+     *          typical record costs one seek and one read.
+     */
+    String readLineFromPos(const size_t cursor_pos, File file, size_t* lineLength = nullptr) const {
+        if (binaryRecords) {
+            RecordHeader header;
+            if (!readHeader(file, cursor_pos, header)) return "";
+            String str;
+            uint8_t buffer[BUFFER_SIZE];
+            uint32_t checksum = 0;
+            for (size_t remaining = header.length, chunk; remaining > 0; remaining -= chunk) {
+                chunk = file.read(buffer, min(BUFFER_SIZE, remaining));
+                MEMORY_LIST_IO(bytesRead, chunk);
+                if (chunk == 0) return "";
+                checksum = crc32(buffer, chunk, checksum);
+                str.concat(reinterpret_cast<const char*>(buffer), chunk);
+            }
+            if (checksum != header.checksum) {DEBUG_PRINT(cursor_pos, "Record checksum mismatch at position"); return "";}
+            if (lineLength) *lineLength = RECORD_HEADER_SIZE + header.length;
+            return isPacked(header.flags) ? unpack(str) : str;
+        }
+        MEMORY_LIST_IO(seeks, 1);
+        if (!file.seek(cursor_pos)) return "";
+        String str;
+        char buffer[BUFFER_SIZE];
+        size_t bytesRead = 0;
+        bool found = false;
+        for (size_t chunk; !found && (chunk = file.read(reinterpret_cast<uint8_t*>(buffer), sizeof(buffer))) > 0; bytesRead += chunk) {
+            const auto* newline = static_cast<const char*>(memchr(buffer, '\n', chunk));
+            found = newline != nullptr;
+            str.concat(buffer, found ? newline - buffer : chunk);
+        }
+        MEMORY_LIST_IO(bytesRead, bytesRead);
+        if (bytesRead == 0) return "";
+        if (lineLength) *lineLength = str.length() + 1;
+        str.trim();
+        return str;
+    }
+
+
+    /**
+     * @brief Measures the raw length of the line starting at a position
+     * @param file Open file handle
+     * @param cursor_pos Starting position in file
+     * @param firstChar Optional pointer to store the first byte of the line
+     * @return Line length in bytes, newline included, or a binary record's length with its header
+     */
+    size_t lineLengthAt(File& file, const size_t cursor_pos, char* firstChar = nullptr) const {
+        if (binaryRecords) {
+            RecordHeader header;
+            if (!readHeader(file, cursor_pos, header)) return 0;
+            if (firstChar) *firstChar = static_cast<char>(header.flags);
+            return RECORD_HEADER_SIZE + header.length;
+        }
+        MEMORY_LIST_IO(seeks, 1);
+        if (!file.seek(cursor_pos)) return 0;
+        uint8_t buffer[64];
+        size_t length = 0;
+        for (size_t bytesRead; (bytesRead = file.read(buffer, sizeof(buffer))) > 0;) {
+            MEMORY_LIST_IO(bytesRead, bytesRead);
+            if (firstChar && length == 0) *firstChar = static_cast<char>(buffer[0]);
+            const auto* newline = static_cast<const uint8_t*>(memchr(buffer, '\n', bytesRead));
+            if (newline) return length + (newline - buffer) + 1;
+            length += bytesRead;
+        }
+        return length;
+    }
+
+
+    /**
+     * @brief Copies the line starting at a position into a caller-provided buffer
+     * @param file Open file handle
+     * @param cursor_pos Starting position in file
+     * @param buffer Destination, NUL-terminated on success
+     * @param bufferSize Size of buffer; needs room for the line ending as well
+     * @return Length of the line without its line ending, 0 on failure or if it does not fit
+     * @details A MessagePack payload is read into buffer and replaced by its JSON text, which
+     *          has to fit as well.
+     */
+    size_t readLineInto(File& file, const size_t cursor_pos, char* buffer, const size_t bufferSize) const {
+        if (!buffer || bufferSize == 0) return 0;
+        buffer[0] = '\0';
+        if (binaryRecords) {
+            RecordHeader header;
+            if (!readHeader(file, cursor_pos, header)) return 0;
+            if (header.length >= bufferSize) {DEBUG_PRINT("Buffer too small for element!"); return 0;}
+            const size_t bytesRead = file.read(reinterpret_cast<uint8_t*>(buffer), header.length);
+            MEMORY_LIST_IO(bytesRead, bytesRead);
+            if (bytesRead != header.length || crc32(reinterpret_cast<const uint8_t*>(buffer), bytesRead) != header.checksum) {
+                DEBUG_PRINT(cursor_pos, "Record checksum mismatch at position");
+                buffer[0] = '\0';
+                return 0;
+            }
+            buffer[bytesRead] = '\0';
+            return isPacked(header.flags) ? unpackInto(buffer, bytesRead, buffer, bufferSize) : bytesRead;
+        }
+        MEMORY_LIST_IO(seeks, 1);
+        if (!file.seek(cursor_pos)) return 0;
+
+        const size_t bytesRead = file.read(reinterpret_cast<uint8_t*>(buffer), bufferSize - 1);
+        MEMORY_LIST_IO(bytesRead, bytesRead);
+        const auto* newline = static_cast<const char*>(memchr(buffer, '\n', bytesRead));
+        if (!newline && bytesRead == bufferSize - 1 && file.available()) {
+            DEBUG_PRINT("Buffer too small for element!");
+            buffer[0] = '\0';
+            return 0;
+        }
+
+        size_t length = newline ? newline - buffer : bytesRead;
+        while (length > 0 && isspace(static_cast<unsigned char>(buffer[length - 1]))) length--;
+        buffer[length] = '\0';
+        return length;
+    }
+
+
+    /**
+     * @brief Deserializes the record starting at a position straight from the file
+     * @param file Open file handle
+     * @param cursor_pos Starting position in file
+     * @param doc Destination document
+     * @return true if successful, false on failure
+     * @details MessagePack payloads are parsed with deserializeMsgPack(), no JSON text involved.
+     */
+    bool deserializeAt(File& file, const size_t cursor_pos, JsonDocument& doc) const {
+        RecordHeader header;
+        if (binaryRecords) {
+            if (!readHeader(file, cursor_pos, header)) return false;
+        } else {
+            MEMORY_LIST_IO(seeks, 1);
+            if (!file.seek(cursor_pos)) return false;
+        }
+        const DeserializationError error = isPacked(header.flags) ? deserializeMsgPack(doc, file) : deserializeJson(doc, file);
+        MEMORY_LIST_IO(bytesRead, file.position() - cursor_pos - payloadOffset());
+        if (error) {DEBUG_PRINT(error.c_str(), "Json deserialization error"); return false;}
+        return true;
+    }
+
+
+    /**
+     * @brief Deserializes a record already read into memory
+     * @param record Raw record, line ending or header included
+     * @param length Raw record length
+     * @param doc Destination document
+     * @return true if successful, false on failure
+     */
+    bool parseRecord(const uint8_t* record, const size_t length, JsonDocument& doc) const {
+        DeserializationError error;
+        if (binaryRecords) {
+            const RecordHeader header = decodeHeader(record);
+            const auto* payload = reinterpret_cast<const char*>(record + RECORD_HEADER_SIZE);
+            error = isPacked(header.flags) ? deserializeMsgPack(doc, payload, header.length) : deserializeJson(doc, payload, header.length);
+        } else {
+            error = deserializeJson(doc, reinterpret_cast<const char*>(record), length);
+        }
+        if (error) {DEBUG_PRINT(error.c_str(), "Json deserialization error"); return false;}
+        return true;
+    }
+
+
+    /**
+     * @brief Checks whether a line starting with the given byte holds a live record
+     * @param firstChar First byte of the line, -1 past the end of the file
+     */
+    static bool isLiveLine(const int firstChar) {
+        return firstChar >= 0 && firstChar != TOMBSTONE && firstChar != '\n';
+    }
+
+
+    /**
+     * @brief Checks whether a byte starts a binary record, live or removed
+     */
+    static bool isBinaryMarker(const int firstByte) {
+        return firstByte >= 0 && ((firstByte & 0xF0) == RECORD_LIVE || firstByte == RECORD_DEAD);
+    }
+
+
+    /**
+     * @brief Checks whether a record starting with the given byte is live, in the file's format
+     * @param firstByte First byte of the record, -1 past the end of the file
+     */
+    bool isLiveRecord(const int firstByte) const {
+        return binaryRecords ? firstByte >= 0 && (firstByte & 0xF0) == RECORD_LIVE : isLiveLine(firstByte);
+    }
+
+
+    /** @brief Byte written over the first byte of a record to remove it */
+    uint8_t tombstoneByte() const {return binaryRecords ? RECORD_DEAD : TOMBSTONE;}
+
+    /** @brief Raw length of a record holding a payload of the given length */
+    size_t recordLength(const size_t payload) const {return payload + (binaryRecords ? RECORD_HEADER_SIZE : 2);}
+
+    /** @brief Offset of the payload inside a record */
+    size_t payloadOffset() const {return binaryRecords ? RECORD_HEADER_SIZE : 0;}
+
+    /** @brief Whether a new or emptied data file gets binary records */
+    bool binaryByDefault() const {
+        return config.format == RecordFormat::Binary || config.encoding == RecordEncoding::MessagePack;
+    }
+
+    /** @brief Whether new records get MessagePack payloads, which only binary records can hold */
+    bool packRecords() const {return binaryRecords && config.encoding == RecordEncoding::MessagePack;}
+
+    /** @brief Checks whether a binary record header announces a MessagePack payload */
+    static bool isPacked(const uint8_t flags) {return (flags & 0xF0) == RECORD_LIVE && (flags & RECORD_MSGPACK);}
+
+    /** @brief Payload length of an element in the encoding of new records */
+    size_t measurePayload(const JsonObjectConst element) const {
+        return packRecords() ? measureMsgPack(element) : measureJson(element);
+    }
+
+    /** @brief Serializes an element in the encoding of new records */
+    template <typename Destination>
+    size_t serializePayload(const JsonObjectConst element, Destination& out) const {
+        return packRecords() ? serializeMsgPack(element, out) : serializeJson(element, out);
+    }
+
+    /** @brief Serializes an element into a buffer in the encoding of new records */
+    size_t serializePayload(const JsonObjectConst element, char* out, const size_t size) const {
+        return packRecords() ? serializeMsgPack(element, out, size) : serializeJson(element, out, size);
+    }
+
+
+    /**
+     * @brief Converts a MessagePack payload to JSON text
+     * @param payload MessagePack bytes
+     * @param length Payload length
+     * @param out Destination, NUL-terminated on success; may be payload itself
+     * @param size Size of out
+     * @return Length of the JSON text, 0 if the payload is invalid or the text does not fit
+     * @details Goes through a JsonDocument, so unlike the rest of the read path it allocates.
+     */
+    static size_t unpackInto(const char* payload, const size_t length, char* out, const size_t size) {
+        JsonDocument doc;
+        const DeserializationError error = deserializeMsgPack(doc, payload, length);
+        if (error) {DEBUG_PRINT(error.c_str(), "MessagePack deserialization error"); return 0;}
+        const size_t json = measureJson(doc);
+        if (json >= size) {DEBUG_PRINT("Buffer too small for element!"); return 0;}
+        serializeJson(doc, out, size);
+        return json;
+    }
+
+
+    /**
+     * @brief Converts a MessagePack payload to a JSON String
+     * @return The JSON text, empty if the payload is invalid
+     */
+    static String unpack(const String& payload) {
+        JsonDocument doc;
+        const DeserializationError error = deserializeMsgPack(doc, payload.c_str(), payload.length());
+        if (error) {DEBUG_PRINT(error.c_str(), "MessagePack deserialization error"); return "";}
+        String json;
+        serializeJson(doc, json);
+        return json;
+    }
+
+
+    /**
+     * @brief CRC-32 (IEEE 802.3) of a byte range
+     * @param crc CRC of the bytes before the range, to checksum data that arrives in pieces
+     */
+    static uint32_t crc32(const uint8_t* bytes, const size_t length, uint32_t crc = 0) {
+        crc = ~crc;
+        for (size_t i = 0; i < length; i++) {
+            crc ^= bytes[i];
+            for (uint8_t bit = 0; bit < 8; bit++) crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+        return ~crc;
+    }
+
+
+    /**
+     * @brief Stores a binary record header in its on-disk layout
+     */
+    static void encodeHeader(const RecordHeader& header, uint8_t* out) {
+        out[0] = header.flags;
+        for (size_t i = 0; i < 4; i++) {
+            out[1 + i] = static_cast<uint8_t>(header.length >> (8 * i));
+            out[5 + i] = static_cast<uint8_t>(header.checksum >> (8 * i));
+        }
+    }
+
+
+    /**
+     * @brief Reads a binary record header from its on-disk layout
+     */
+    static RecordHeader decodeHeader(const uint8_t* in) {
+        RecordHeader header;
+        header.flags = in[0];
+        for (size_t i = 0; i < 4; i++) {
+            header.length |= static_cast<uint32_t>(in[1 + i]) << (8 * i);
+            header.checksum |= static_cast<uint32_t>(in[5 + i]) << (8 * i);
+        }
+        return header;
+    }
+
+
+    /**
+     * @brief Reads the binary record header at a position, leaving the file at the payload
+     * @param file Open file handle
+     * @param cursor_pos Starting position in file
+     * @param header Set to the header read
+     * @return true if it is a record header, live or removed, whose payload lies within the file
+     */
+    bool readHeader(File& file, const size_t cursor_pos, RecordHeader& header) const {
+        uint8_t bytes[RECORD_HEADER_SIZE];
+        MEMORY_LIST_IO(seeks, 1);
+        if (!file.seek(cursor_pos) || file.read(bytes, RECORD_HEADER_SIZE) != RECORD_HEADER_SIZE) return false;
+        MEMORY_LIST_IO(bytesRead, RECORD_HEADER_SIZE);
+        header = decodeHeader(bytes);
+        return isBinaryMarker(header.flags) && static_cast<size_t>(file.available()) >= header.length;
+    }
+
+
+    /**
+     * @brief Frames a payload serialized at record + payloadOffset() as one record
+     * @details The payload is taken to be in the encoding of new records, see packRecords().
+     * @param record Start of the record, with room for the framing around the payload
+     * @param payload Payload length
+     * @return Raw record length
+     */
+    size_t sealRecord(char* record, const size_t payload) const {
+        if (!binaryRecords) {
+            memcpy(record + payload, "\r\n", 2);
+            return payload + 2;
+        }
+        RecordHeader header;
+        header.flags = packRecords() ? RECORD_LIVE | RECORD_MSGPACK : RECORD_LIVE;
+        header.length = payload;
+        header.checksum = crc32(reinterpret_cast<const uint8_t*>(record + RECORD_HEADER_SIZE), payload);
+        encodeHeader(header, reinterpret_cast<uint8_t*>(record));
+        return RECORD_HEADER_SIZE + payload;
+    }
+
+
+    /**
+     * @brief Visits the records of a file in order, live and removed alike
+     * @param file Open file handle
+     * @param start Offset of a record start
+     * @param buffer Scratch buffer the file is read through, at least RECORD_HEADER_SIZE bytes
+     * @param bufferSize Size of buffer
+     * @param visit Called as visit(offset, length, live) with each record's raw length; returning
+     *        false stops the walk. It may move the file position. A visitor that also takes a
+     *        `const uint8_t*` gets the record's bytes when the whole record is in buffer, nullptr
+     *        when it is not.
+     * @return Offset the walk stopped at: the end of the file, the record visit() declined, or in
+     *         the binary format a header that does not describe a record within the file
+     * @details Text lines are split with memchr, and an unterminated last line counts as a
+     *          record. Binary records are stepped over by their headers without reading the
+     *          payloads, so a record that does not share the buffer with the one before costs a
+     *          single seek.
+     */
+    template <typename Visit>
+    size_t walkRecords(File& file, const size_t start, uint8_t* buffer, const size_t bufferSize, Visit&& visit) const {
+        const size_t fileSize = sizeOf(file);
+        size_t windowStart = start;  // file offset of buffer[0]
+        size_t windowLength = 0;
+        const auto fill = [&](const size_t offset) {
+            if (file.position() != offset) {
+                MEMORY_LIST_IO(seeks, 1);
+                if (!file.seek(offset)) return false;
+            }
+            windowStart = offset;
+            windowLength = file.read(buffer, min(bufferSize, fileSize - offset));
+            MEMORY_LIST_IO(bytesRead, windowLength);
+            return windowLength > 0;
+        };
+        const auto call = [&](const size_t offset, const size_t length, const bool live) {
+            if constexpr (std::is_invocable_v<Visit, size_t, size_t, bool, const uint8_t*>) {
+                const bool inWindow = offset >= windowStart && offset + length <= windowStart + windowLength;
+                return visit(offset, length, live, inWindow ? buffer + (offset - windowStart) : nullptr);
+            } else {
+                return visit(offset, length, live);
+            }
+        };
+
+        if (binaryRecords) {
+            size_t offset = start;
+            while (offset < fileSize) {
+                if (fileSize - offset < RECORD_HEADER_SIZE) return offset;
+                if (offset < windowStart || offset + RECORD_HEADER_SIZE > windowStart + windowLength) {
+                    if (!fill(offset) || windowLength < RECORD_HEADER_SIZE) return offset;
+                }
+                const RecordHeader header = decodeHeader(buffer + (offset - windowStart));
+                if (!isBinaryMarker(header.flags) || header.length > fileSize - offset - RECORD_HEADER_SIZE) return offset;
+                const size_t length = RECORD_HEADER_SIZE + header.length;
+                if (!call(offset, length, isLiveRecord(header.flags))) return offset;
+                offset += length;
+            }
+            return offset;
+        }
+
+        size_t lineStart = start;
+        bool atLineStart = true;
+        bool lineLive = false;
+        for (size_t position = start; position < fileSize && fill(position); position += windowLength) {
+            for (size_t i = 0; i < windowLength;) {
+                if (atLineStart) {
+                    lineStart = position + i;
+                    lineLive = isLiveLine(buffer[i]);
+                    atLineStart = false;
+                }
+                const auto* newline = static_cast<const uint8_t*>(memchr(buffer + i, '\n', windowLength - i));
+                if (!newline) break;
+                i = newline - buffer + 1;
+                if (!call(lineStart, position + i - lineStart, lineLive)) return lineStart;
+                atLineStart = true;
+            }
+        }
+        // Last line without a line ending
+        if (!atLineStart && !call(lineStart, fileSize - lineStart, lineLive)) return lineStart;
+        return fileSize;
+    }
+
+
+    /**
+     * @brief Finds the byte offset of a live line without building any String
+     * @param dataFile Open data file handle
+     * @param line_no Index of the live line to find
+     * @param offset Set to the line's byte offset on success
+     * @return true if the line exists
+     * @details One index lookup when the index is enabled, otherwise a forward scan through a
+     *          stack buffer from the last checkpoint at or before line_no, or from the head
+     *          offset when there is none. With checkpoints the scan covers about checkpointStride
+     *          records wherever the line is.
+     */
+    bool locateLine(File& dataFile, const size_t line_no, size_t& offset) const {
+        if (line_no >= currentSize) return false;
+        if (config.useIndex) return readIndexEntries(line_no, 1, &offset) == 1;
+        const size_t nearest = checkpointsUpTo(line_no);
+        if (nearest == 0) return scanForLine(dataFile, headOffset, line_no, offset);
+        const Checkpoint& checkpoint = checkpoints[nearest - 1];
+        return scanForLine(dataFile, checkpoint.offset, line_no - checkpoint.index, offset);
+    }
+
+
+    /**
+     * @brief Scans forward for a live record through a stack buffer
+     * @param file Open file handle
+     * @param start Position of a line start at or before the first live line
+     * @param line_no Number of live lines to skip
+     * @param offset Set to the line's byte offset on success
+     * @param lineLength Optional pointer to store the line's raw length, line ending included
+     * @return true if the line exists
+     */
+    bool scanForLine(File& file, const size_t start, const size_t line_no, size_t& offset, size_t* lineLength = nullptr) const {
+        uint8_t buffer[BUFFER_SIZE];
+        size_t validLineCount = 0;
+        bool found = false;
+        walkRecords(file, start, buffer, sizeof(buffer), [&](const size_t lineStart, const size_t length, const bool live) {
+            if (!live || validLineCount++ < line_no) return true;
+            offset = lineStart;
+            if (lineLength) *lineLength = length;
+            found = true;
+            return false;
+        });
+        return found;
+    }
+
+
+    /**
+     * @brief Number of checkpoints whose index is at most line_no, by binary search
+     */
+    size_t checkpointsUpTo(const size_t line_no) const {
+        size_t low = 0;
+        size_t high = checkpointCount;
+        while (low < high) {
+            const size_t middle = low + (high - low) / 2;
+            if (checkpoints[middle].index <= line_no) low = middle + 1;
+            else high = middle;
+        }
+        return low;
+    }
+
+
+    /** @brief Stride the checkpoint table starts with, 0 when there is none */
+    size_t initialStride() const {
+        if (config.checkpointInterval) return config.checkpointInterval;
+        return config.checkpointBudget ? 1 : 0;
+    }
+
+
+    /**
+     * @brief Adds a checkpoint for a live record when it is a stride past the last one
+     * @param index Index of the record, past every checkpoint
+     * @param offset Byte offset of the record
+     * @details Index 0 needs none, the head offset serves it. A full table under
+     *          config.checkpointBudget is thinned out first, otherwise it grows; if it cannot
+     *          grow the record goes without, and the table stays correct, only sparser.
+     */
+    void checkpointRecord(const size_t index, const size_t offset) {
+        if (!checkpointStride || config.useIndex) return;
+        if (index < (checkpointCount ? checkpoints[checkpointCount - 1].index : 0) + checkpointStride) return;
+        if (checkpointCount == checkpointCapacity) {
+            if (config.checkpointBudget) thinCheckpoints();
+            else if (!growCheckpoints()) return;
+            if (checkpointCount == checkpointCapacity) return;
+            if (checkpointCount && index < checkpoints[checkpointCount - 1].index + checkpointStride) return;
+        }
+        Checkpoint& checkpoint = checkpoints[checkpointCount++];
+        checkpoint.index = index;
+        checkpoint.offset = offset;
+    }
+
+
+    /**
+     * @brief Doubles the checkpoint table on the heap, for lists without a checkpoint budget
+     * @return true if the table has room for another checkpoint
+     */
+    bool growCheckpoints() {
+        const size_t capacity = max(checkpointCapacity * 2, static_cast<size_t>(16));
+        auto* grown = static_cast<Checkpoint*>(realloc(checkpoints, capacity * sizeof(Checkpoint)));
+        if (!grown) {DEBUG_PRINT("Failed to grow the checkpoint table!"); return false;}
+        checkpoints = grown;
+        checkpointCapacity = capacity;
+        return true;
+    }
+
+
+    /**
+     * @brief Halves a full checkpoint table by dropping every other checkpoint, doubling the stride
+     * @details The only way a table under config.checkpointBudget makes room, so it covers
+     *          any number of records at a fixed size.
+     */
+    void thinCheckpoints() {
+        size_t kept = 0;
+        for (size_t i = 1; i < checkpointCount; i += 2) checkpoints[kept++] = checkpoints[i];
+        checkpointCount = kept;
+        checkpointStride *= 2;
+    }
+
+
+    /**
+     * @brief Repairs the checkpoints after records were tombstoned
+     * @param removedBefore Called with each checkpoint's index in ascending order, returns how
+     *        many of the removed records had a lower index
+     * @details Called once currentSize is updated. A checkpoint moves down by the removed
+     *          records before it. One on a removed record keeps its offset, as only removed
+     *          records lie between it and the live record that now has its new index. Of
+     *          checkpoints that end up on one index only the last is kept, and those on index 0
+     *          or past the end go.
+     */
+    template <typename RemovedBefore>
+    void shiftCheckpoints(RemovedBefore&& removedBefore) {
+        size_t kept = 0;
+        for (size_t i = 0; i < checkpointCount; i++) {
+            Checkpoint checkpoint = checkpoints[i];
+            checkpoint.index -= removedBefore(checkpoint.index);
+            if (checkpoint.index == 0 || checkpoint.index >= currentSize) continue;
+            if (kept && checkpoints[kept - 1].index == checkpoint.index) kept--;
+            checkpoints[kept++] = checkpoint;
+        }
+        checkpointCount = kept;
+    }
+
+
+    /**
+     * @brief Repairs the checkpoints after a run of consecutive records was tombstoned
+     * @param first Index the first removed record had
+     * @param count Number of records removed
+     */
+    void shiftCheckpoints(const size_t first, const size_t count) {
+        shiftCheckpoints([&](const size_t index) {return index <= first ? 0 : min(index - first, count);});
+    }
+
+
+    /**
+     * @brief Fills the checkpoint table with one pass from the head
+     * @details For a start from saved state, which replaces the construction scan that fills
+     *          the table otherwise.
+     */
+    void rebuildCheckpoints() {
+        checkpointCount = 0;
+        checkpointStride = initialStride();
+        if (!checkpointStride || config.useIndex || currentSize <= checkpointStride) return;
+        File dataFile = openDataFile(FILE_READ);
+        if (!dataFile) {DEBUG_PRINT("Failed to open file for reading!"); return;}
+
+        uint8_t buffer[BUFFER_SIZE];
+        size_t index = 0;
+        walkRecords(dataFile, headOffset, buffer, sizeof(buffer), [&](const size_t offset, size_t, const bool live) {
+            if (live) checkpointRecord(index++, offset);
+            return index < currentSize;
+        });
+        closeDataFile(dataFile);
+    }
+
+
+    /**
+     * @brief Records the position of the last live record
+     */
+    void setTail(const size_t offset, const size_t length) const {
+        tailOffset = offset;
+        tailLength = length;
+        tailKnown = true;
+    }
+
+
+    /**
+     * @brief Finds the byte offset of the last live line without building any String
+     * @param dataFile Open data file handle
+     * @param offset Set to the line's byte offset on success
+     * @return true if the list holds a live line
+     * @details Served from the cached tail when it is known. Otherwise one index lookup, or a
+     *          backward scan from the end of the file in BUFFER_SIZE chunks that stops at the
+     *          head offset; either result is cached for the next call. Binary records can only
+     *          be found front to back, so there the scan walks their headers from the last
+     *          checkpoint, or the head offset without one.
+     */
+    bool locateLast(File& dataFile, size_t& offset) const {
+        if (currentSize == 0) return false;
+        if (tailKnown) {offset = tailOffset; return true;}
+        if (config.useIndex) {
+            if (readIndexEntries(currentSize - 1, 1, &offset) != 1) return false;
+            setTail(offset, lineLengthAt(dataFile, offset));
+            return true;
+        }
+        if (binaryRecords) {
+            uint8_t buffer[BUFFER_SIZE];
+            size_t lastLength = 0;
+            const size_t start = checkpointCount ? checkpoints[checkpointCount - 1].offset : headOffset;
+            walkRecords(dataFile, start, buffer, sizeof(buffer), [&](const size_t recordOffset, const size_t length, const bool live) {
+                if (live) {offset = recordOffset; lastLength = length;}
+                return true;
+            });
+            if (lastLength == 0) return false;
+            setTail(offset, lastLength);
+            return true;
+        }
+
+        const size_t fileSize = sizeOf(dataFile);
+        uint8_t buffer[BUFFER_SIZE];
+        int next = -1;             // byte just after the one being scanned, -1 past the end of the file
+        size_t lineEnd = fileSize; // one past the line ending of the line after the one being scanned
+        for (size_t end = fileSize; end > headOffset;) {
+            const size_t readSize = min(BUFFER_SIZE, end - headOffset);
+            const size_t pos = end - readSize;
+            MEMORY_LIST_IO(seeks, 1);
+            MEMORY_LIST_IO(bytesRead, readSize);
+            if (!dataFile.seek(pos) || dataFile.read(buffer, readSize) != readSize) {DEBUG_PRINT(pos, "Failed to read at position"); return false;}
+
+            for (size_t i = readSize; i-- > 0;) {
+                if (buffer[i] == '\n') {
+                    const size_t lineStart = pos + i + 1;
+                    if (isLiveLine(next)) {setTail(lineStart, lineEnd - lineStart); offset = lineStart; return true;}
+                    lineEnd = lineStart;
+                }
+                next = buffer[i];
+            }
+            end = pos;
+        }
+        // The head offset always starts a line
+        if (isLiveLine(next)) {setTail(headOffset, lineEnd - headOffset); offset = headOffset; return true;}
+        return false;
+    }
+
+
+    /**
+     * @brief Accounts for one live line found by the construction scan
+     * @param offset Byte offset of the line
+     * @param length Raw line length, line ending included
+     */
+    void seedLiveLine(const size_t offset, const size_t length) {
+        if (currentSize++ == 0) headOffset = offset;
+        checkpointRecord(currentSize - 1, offset);
+        liveBytes += length;
+        maxRecordLength = max(maxRecordLength, length);
+        MEMORY_LIST_IO_MAX(largestRecord, length);
+        setTail(offset, length);
+    }
+
+
+    /**
+     * @brief Fills all derived state with one pass over the file
+     * @details Runs once at construction and sets currentSize, liveBytes, deadBytes,
+     *          headOffset, the tail and maxRecordLength together. Records are walked in a
+     *          SCAN_BUFFER_SIZE heap buffer (BUFFER_SIZE on the stack if that allocation
+     *          fails) without building any String. Afterwards every mutation keeps this state
+     *          current, so nothing rescans the file. With config.persistState a clean metadata
+     *          record that matches the file replaces the pass entirely; otherwise the pass starts
+     *          at the saved head instead of byte 0. The first byte of the file decides its
+     *          format; an empty file is binary when config.format or config.encoding asks for it.
+     */
+    void seedCounters() {
+        currentSize = 0;
+        liveBytes = 0;
+        deadBytes = 0;
+        headOffset = 0;
+        maxRecordLength = 0;
+        tailKnown = false;
+        binaryRecords = binaryByDefault();
+        File dataFile = openDataFile(FILE_READ);
+        if (!dataFile) {DEBUG_PRINT("Failed to open file for reading!"); return;}
+
+        const size_t fileSize = sizeOf(dataFile);
+        if (fileSize > 0) {
+            MEMORY_LIST_IO(bytesRead, 1);
+            binaryRecords = isBinaryMarker(dataFile.read());
+        }
+        size_t start = 0;
+        if (config.persistState && loadState(dataFile, fileSize, start)) {closeDataFile(dataFile); return;}
+        headOffset = fileSize;
+
+        uint8_t stackBuffer[BUFFER_SIZE];
+        auto* heapBuffer = static_cast<uint8_t*>(malloc(SCAN_BUFFER_SIZE));
+        uint8_t* buffer = heapBuffer ? heapBuffer : stackBuffer;
+        const size_t bufferSize = heapBuffer ? SCAN_BUFFER_SIZE : BUFFER_SIZE;
+
+        const size_t end = walkRecords(dataFile, start, buffer, bufferSize, [&](const size_t offset, const size_t length, const bool live) {
+            if (live) seedLiveLine(offset, length);
+            return true;
+        });
+        free(heapBuffer);
+        closeDataFile(dataFile);
+
+        const size_t dataSize = end < fileSize ? sealTornTail(end, fileSize) : fileSize;
+        liveBytes = min(liveBytes, dataSize);
+        deadBytes = dataSize - liveBytes;
+    }
+
+
+    /**
+     * @brief Turns the bytes after the last readable binary record into one removed record
+     * @param offset Position of the first header that does not describe a record within the file
+     * @param fileSize Size of the data file
+     * @return Size of the data file afterwards
+     * @details A write cut short by a reset leaves a header whose record runs past the end of
+     *          the file, and anything appended after it would be unreachable. Covering the bytes
+     *          with a removed record keeps the file walkable; the next defragmentation drops them.
+     */
+    size_t sealTornTail(const size_t offset, const size_t fileSize) {
+        DEBUG_PRINT(offset, "Torn record, sealing the file from position");
+        RecordHeader header;
+        header.flags = RECORD_DEAD;
+        header.length = max(fileSize, offset + RECORD_HEADER_SIZE) - offset - RECORD_HEADER_SIZE;
+        uint8_t bytes[RECORD_HEADER_SIZE];
+        encodeHeader(header, bytes);
+
+        File dataFile = SD.open(filePath, FILE_READ_WRITE);
+        MEMORY_LIST_IO(opens, 1);
+        MEMORY_LIST_IO(seeks, 1);
+        MEMORY_LIST_IO(bytesWritten, RECORD_HEADER_SIZE);
+        const bool status = dataFile && dataFile.seek(offset) && dataFile.write(bytes, RECORD_HEADER_SIZE) == RECORD_HEADER_SIZE;
+        if (dataFile) dataFile.close();
+        if (!status) {DEBUG_PRINT("Failed to seal torn record!"); return fileSize;}
+        return offset + RECORD_HEADER_SIZE + header.length;
+    }
+
+
+    /**
+     * @brief Path of the sidecar metadata file
+     */
+    [[nodiscard]] String metaPath() const {
+        return filePath + ".meta";
+    }
+
+
+    /**
+     * @brief CRC-32 of a metadata record, excluding its checksum field
+     */
+    static uint32_t metaChecksum(const MetaRecord& record) {
+        return crc32(reinterpret_cast<const uint8_t*>(&record), offsetof(MetaRecord, checksum));
+    }
+
+
+    /**
+     * @brief Reads the metadata file and checks it against the data file
+     * @param dataFile Open data file handle
+     * @param fileSize Size of the data file
+     * @param start Set to the saved head offset if it is usable, 0 otherwise
+     * @return true if the saved state was adopted and no scan is needed
+     * @details The record must be intact, marked clean, and describe exactly fileSize bytes.
+     *          A valid head lies within the file and starts a record, see startsRecord().
+     */
+    bool loadState(File& dataFile, const size_t fileSize, size_t& start) {
+        start = 0;
+        File metaFile = SD.open(metaPath(), FILE_READ);
+        if (!metaFile) return false;
+        MetaRecord record;
+        const bool readOk = metaFile.read(reinterpret_cast<uint8_t*>(&record), sizeof(MetaRecord)) == sizeof(MetaRecord);
+        metaFile.close();
+
+        if (!readOk || record.magic != META_MAGIC || record.checksum != metaChecksum(record)) return false;
+        if (record.headOffset > fileSize) return false;
+        if (!startsRecord(dataFile, record.headOffset, fileSize)) return false;
+        start = record.headOffset;
+
+        if (!record.clean || record.dataSize != fileSize) return false;
+        if (record.liveBytes + record.deadBytes != fileSize || record.tailOffset + record.tailLength > fileSize) return false;
+        currentSize = record.count;
+        liveBytes = record.liveBytes;
+        deadBytes = record.deadBytes;
+        headOffset = record.headOffset;
+        maxRecordLength = record.maxRecordLength;
+        if (record.count && record.tailLength) setTail(record.tailOffset, record.tailLength);
+        stateClean = true;
+        return true;
+    }
+
+
+    /**
+     * @brief Checks that a saved offset can start a record
+     * @param dataFile Open data file handle
+     * @param offset Offset to check, at most fileSize
+     * @param fileSize Size of the data file
+     * @details Text records start the file or follow a newline. A binary offset must be the end
+     *          of the file or hold a record marker, as headers carry no backward link.
+     */
+    bool startsRecord(File& dataFile, const size_t offset, const size_t fileSize) const {
+        if (offset == 0) return true;
+        MEMORY_LIST_IO(seeks, 1);
+        if (binaryRecords) return offset == fileSize || (dataFile.seek(offset) && isBinaryMarker(dataFile.read()));
+        return dataFile.seek(offset - 1) && dataFile.read() == '\n';
+    }
+
+
+    /**
+     * @brief Writes the derived state to the metadata file when config.persistState is set
+     * @param clean Whether the record may replace the construction scan
+     * @return true if saved or not needed, false on failure
+     * @details The record is flushed right away in session mode as well, so a dirty mark
+     *          always reaches the card before the data writes it covers.
+     */
+    bool saveState(const bool clean) {
+        if (!config.persistState) return true;
+        File metaFile = sessionMeta ? rewind(sessionMeta, FILE_WRITE) : SD.open(metaPath(), FILE_WRITE);
+        MEMORY_LIST_IO(seeks, sessionMeta ? 1 : 0);
+        MEMORY_LIST_IO(opens, sessionMeta ? 0 : 1);
+        if (!metaFile) {DEBUG_PRINT("Failed to open metadata file for writing!"); stateClean = false; return false;}
+
+        MetaRecord record;
+        record.clean = clean;
+        record.dataSize = liveBytes + deadBytes;
+        record.count = currentSize;
+        record.liveBytes = liveBytes;
+        record.deadBytes = deadBytes;
+        record.headOffset = headOffset;
+        record.tailOffset = tailKnown ? tailOffset.load() : 0;
+        record.tailLength = tailKnown ? tailLength.load() : 0;
+        record.maxRecordLength = maxRecordLength;
+        record.checksum = metaChecksum(record);
+        const bool status = metaFile.write(reinterpret_cast<const uint8_t*>(&record), sizeof(MetaRecord)) == sizeof(MetaRecord);
+        MEMORY_LIST_IO(bytesWritten, sizeof(MetaRecord));
+        if (sessionMeta) {metaFile.flush(); MEMORY_LIST_IO(flushes, 1);}
+        else metaFile.close();
+        stateClean = clean && status;
+        return status;
+    }
+
+
+    /**
+     * @brief Marks the saved state stale before the first mutation after a clean save
+     * @details Costs one small write per clean-to-dirty transition, not one per operation
+     */
+    void markDirty() {
+        if (stateClean) saveState(false);
+    }
+
+
+    /**
+     * @brief Moves a tombstoned record's bytes from the live to the dead counter
+     * @param lineLength Raw length of the removed line
+     */
+    void accountRemoved(const size_t lineLength) {
+        const size_t bytes = min(lineLength, liveBytes);
+        liveBytes -= bytes;
+        deadBytes += bytes;
+    }
+
+
+    /**
+     * @brief Tombstones the first live lines at or after a position
+     * @param file Open file handle
+     * @param cursor Line start to begin at, advanced past the last line visited
+     * @param count Number of live lines to tombstone
+     * @param bytes Increased by the raw length of every tombstoned line
+     * @return Number of lines tombstoned
+     */
+    size_t tombstoneFrom(File& file, size_t& cursor, const size_t count, size_t& bytes) const {
+        const size_t fileSize = sizeOf(file);
+        size_t removed = 0;
+        while (removed < count && cursor < fileSize) {
+            char firstChar = 0;
+            const size_t lineLength = lineLengthAt(file, cursor, &firstChar);
+            if (lineLength == 0) break;
+            if (lineLength > 1 && isLiveRecord(static_cast<uint8_t>(firstChar))) {
+                MEMORY_LIST_IO(seeks, 1);
+                MEMORY_LIST_IO(bytesWritten, 1);
+                if (!file.seek(cursor, SeekSet) || !file.write(tombstoneByte())) break;
+                removed++;
+                bytes += lineLength;
+            }
+            cursor += lineLength;
+        }
+        return removed;
+    }
+
+
+    /**
+     * @brief Path of the temp file defragmentation copies into
+     */
+    [[nodiscard]] String tempFilePath() const {
+        return filePath + ".tmp";
+    }
+
+
+    /**
+     * @brief Starts an incremental defragmentation with an empty temp file
+     * @return true if started, false if there is nothing to reclaim or on failure
+     */
+    bool beginCompaction() {
+        if (deadBytes == 0) return false;
+        File tempFile = SD.open(tempFilePath(), FILE_WRITE);
+        MEMORY_LIST_IO(opens, 1);
+        if (!tempFile) {DEBUG_PRINT("Failed to create temp file!"); return false;}
+        tempFile.close();
+
+        compaction = Compaction();
+        compaction.active = true;
+        compaction.source = headOffset;
+        return true;
+    }
+
+
+    /**
+     * @brief Drops the compaction in progress, if any, along with its temp file
+     */
+    void abortCompaction() {
+        if (!compaction.active) return;
+        SD.remove(tempFilePath());
+        compaction = Compaction();
+    }
+
+
+    /**
+     * @brief Repeats the removal of a record on its copy in the temp file
+     * @param index Index the record had in the list
+     * @details Records at or past compaction.copied have not been copied yet and need nothing.
+     *          If the copy cannot be updated the compaction starts over.
+     */
+    void mirrorRemove(const size_t index) {
+        if (!compaction.active || index >= compaction.copied) return;
+        File tempFile = SD.open(tempFilePath(), FILE_READ_WRITE);
+        MEMORY_LIST_IO(opens, 1);
+
+        size_t offset = 0;
+        size_t lineLength = 0;
+        if (tempFile && scanForLine(tempFile, compaction.head, index, offset)) lineLength = lineLengthAt(tempFile, offset);
+        MEMORY_LIST_IO(seeks, 1);
+        MEMORY_LIST_IO(bytesWritten, 1);
+        const bool status = lineLength > 0 && tempFile.seek(offset) && tempFile.write(tombstoneByte()) == 1;
+        if (tempFile) tempFile.close();
+        if (!status) {DEBUG_PRINT("Failed to update temp file, compaction restarted!"); abortCompaction(); return;}
+
+        if (index == compaction.copied - 1) compaction.tailLength = 0;
+        compaction.copied--;
+        compaction.deadBytes += lineLength;
+        if (index == 0) compaction.head = offset + lineLength;
+    }
+
+
+    /**
+     * @brief Repeats a removeFirst() on the records already copied to the temp file
+     * @param removed Number of records removed from the head of the list
+     */
+    void mirrorRemoveFirst(const size_t removed) {
+        const size_t count = min(removed, compaction.copied);
+        if (!compaction.active || count == 0) return;
+        File tempFile = SD.open(tempFilePath(), FILE_READ_WRITE);
+        MEMORY_LIST_IO(opens, 1);
+
+        size_t bytes = 0;
+        const bool status = tempFile && tombstoneFrom(tempFile, compaction.head, count, bytes) == count;
+        if (tempFile) tempFile.close();
+        if (!status) {DEBUG_PRINT("Failed to update temp file, compaction restarted!"); abortCompaction(); return;}
+
+        if (count == compaction.copied) compaction.tailLength = 0;
+        compaction.copied -= count;
+        compaction.deadBytes += bytes;
+    }
+
+
+    /**
+     * @brief Replaces the data file with the fully copied temp file
+     * @return true if successful, false on failure
+     * @details The counters, head, tail and longest record carry over from the compaction, and
+     *          the checkpoints take the offsets it noted while copying. An empty result takes
+     *          config.format.
+     */
+    bool finishCompaction() {
+        if (compaction.copied != currentSize) {DEBUG_PRINT("Compaction out of step with the list, restarting"); abortCompaction(); return false;}
+        const Compaction done = compaction;
+        compaction = Compaction();
+
+        endSession();
+        // A head of 0 is valid for the old and the new file, so save it before swapping them
+        headOffset = 0;
+        saveState(false);
+        if (!SD.remove(filePath)) {DEBUG_PRINT("Failed to remove original file!");
+            SD.remove(tempFilePath());
+            if (config.keepOpen) beginSession();
+            return false;
+        }
+        if (!SD.rename(tempFilePath(), filePath)) {DEBUG_PRINT("Failed to rename temp file!");
+            SD.remove(tempFilePath());
+            if (config.keepOpen) beginSession();
+            return false;
+        }
+        if (config.keepOpen) beginSession();
+
+        liveBytes = done.size - done.deadBytes;
+        deadBytes = done.deadBytes;
+        headOffset = done.head;
+        maxRecordLength = done.longest;
+        if (done.copied && done.tailLength) setTail(done.tailOffset, done.tailLength);
+        else tailKnown = false;
+        if (done.size == 0) binaryRecords = binaryByDefault();
+        if (config.useIndex) rebuildIndex();
+        for (size_t i = 0; i < checkpointCount; i++) checkpoints[i].offset = checkpoints[i].moved;
+        saveState(true);
+        MEMORY_LIST_IO(defragmentRuns, 1);
+        return true;
+    }
+
+
+    /**
+     * @brief Copies live records from the data file to the temp file for the compaction in progress
+     * @param byteBudget Data file bytes to process, at least one record is processed
+     * @param microsBudget Optional time limit, 0 for none
+     * @param done Set once every record of the data file has been processed
+     * @return true if successful, false on failure, which drops the compaction
+     * @details Walks the records from compaction.source and stops only at record boundaries.
+     *          Consecutive live records are copied as one run through a BUFFER_SIZE buffer;
+     *          removed binary records are stepped over without being read. A checkpoint on a
+     *          copied record notes where the copy went, see finishCompaction().
+     */
+    bool copyRecords(const size_t byteBudget, const unsigned long microsBudget, bool& done) {
+        const unsigned long started = micros();
+        File sourceFile = openDataFile(FILE_READ);
+        File tempFile = SD.open(tempFilePath(), FILE_APPEND);
+        MEMORY_LIST_IO(opens, 1);
+        if (!sourceFile || !tempFile) {
+            DEBUG_PRINT("Failed to open files!");
+            if (sourceFile) closeDataFile(sourceFile);
+            if (tempFile) tempFile.close();
+            abortCompaction();
+            return false;
+        }
+
+        const size_t first = compaction.source;
+        size_t runStart = first;  // live records not copied yet: [runStart, runEnd)
+        size_t runEnd = first;
+        bool status = true;
+        bool paused = false;
+        uint8_t copyBuffer[BUFFER_SIZE];
+        const auto copyRun = [&] {
+            MEMORY_LIST_IO(seeks, runEnd > runStart ? 1 : 0);
+            if (runEnd > runStart && !sourceFile.seek(runStart)) status = false;
+            for (size_t from = runStart, chunk; status && from < runEnd; from += chunk) {
+                chunk = min(BUFFER_SIZE, runEnd - from);
+                MEMORY_LIST_IO(bytesRead, chunk);
+                MEMORY_LIST_IO(bytesWritten, chunk);
+                status = sourceFile.read(copyBuffer, chunk) == chunk && tempFile.write(copyBuffer, chunk) == chunk;
+                if (status) compaction.size += chunk;
+            }
+            runStart = runEnd;
+        };
+
+        uint8_t buffer[BUFFER_SIZE];
+        const size_t stop = walkRecords(sourceFile, first, buffer, sizeof(buffer), [&](const size_t offset, const size_t length, const bool live) {
+            const size_t processed = offset - first;
+            if (processed > 0 && (processed >= byteBudget || (microsBudget && micros() - started >= microsBudget))) {
+                paused = true;
+                return false;
+            }
+            if (live) {
+                if (offset != runEnd) {
+                    copyRun();
+                    runStart = offset;
+                }
+                runEnd = offset + length;
+                compaction.tailOffset = compaction.size + (offset - runStart);
+                compaction.tailLength = length;
+                const size_t nearest = checkpointsUpTo(compaction.copied);
+                if (nearest && checkpoints[nearest - 1].index == compaction.copied) checkpoints[nearest - 1].moved = compaction.tailOffset;
+                compaction.copied++;
+                compaction.longest = max(compaction.longest, length);
+            }
+            compaction.source = offset + length;
+            return status;
+        });
+        if (status) copyRun();
+        done = stop == sizeOf(sourceFile);
+        if (status && !done && !paused) {DEBUG_PRINT(stop, "Unreadable record at position"); status = false;}
+        closeDataFile(sourceFile);
+        tempFile.close();
+
+        if (!status) {DEBUG_PRINT("Compaction step failed!"); abortCompaction(); return false;}
+        return true;
+    }
+
+
+    /**
+     * @brief Rewinds a session handle so it can stand in for a freshly opened file
+     * @param session Open session handle
+     * @param mode Requested open mode; FILE_APPEND positions the handle at the end
+     * @return The session handle
+     * @details Touches neither the heap nor the FAT, unlike SD.open()
+     */
+    static File rewind(File& session, const char* mode) {
+        session.seek(0, strcmp(mode, FILE_APPEND) == 0 ? SeekEnd : SeekSet);
+        return session;
+    }
+
+
+    /**
+     * @brief Opens the data file, reusing the session handle in session mode
+     */
+    [[nodiscard]] File openDataFile(const char* mode) const {
+        MEMORY_LIST_IO(seeks, sessionData ? 1 : 0);
+        MEMORY_LIST_IO(opens, sessionData ? 0 : 1);
+        return sessionData ? rewind(sessionData, mode) : SD.open(filePath, mode);
+    }
+
+
+    /**
+     * @brief Closes a data file handle unless it is the session handle
+     */
+    void closeDataFile(File& file) const {
+        if (!sessionData) file.close();
+    }
+
+
+    /**
+     * @brief Opens the index file, reusing the session handle in session mode
+     * @details FILE_WRITE does not truncate a session handle; stale trailing entries are ignored by loadIndex()
+     */
+    [[nodiscard]] File openIndexFile(const char* mode) const {
+        MEMORY_LIST_IO(seeks, sessionIndex ? 1 : 0);
+        MEMORY_LIST_IO(opens, sessionIndex ? 0 : 1);
+        return sessionIndex ? rewind(sessionIndex, mode) : SD.open(indexPath(), mode);
+    }
+
+
+    /**
+     * @brief Closes an index file handle unless it is the session handle
+     */
+    void closeIndexFile(File& file) const {
+        if (!sessionIndex) file.close();
+    }
+
+
+    /**
+     * @brief Size of an open file, including writes still buffered in the handle
+     * @param file Open file handle, its position is preserved
+     * @return File size in bytes
+     * @details File::size() reports what has reached the card, which lags behind a
+     *          session handle's buffer. Seeking pushes pending writes out first.
+     */
+    size_t sizeOf(File& file) const {
+        MEMORY_LIST_IO(seeks, 2);
+        const size_t position = file.position();
+        if (!file.seek(0, SeekEnd)) return file.size();
+        const size_t size = file.position();
+        file.seek(position);
+        return size;
+    }
+
+
+    /**
+     * @brief Opens the handles held for the list's lifetime in session mode
+     * @return true if the data file handle is open
+     */
+    bool beginSession() {
+        sessionData = SD.open(filePath, FILE_READ_WRITE);
+        if (config.useIndex) sessionIndex = SD.open(indexPath(), FILE_READ_WRITE);
+        if (config.persistState) sessionMeta = SD.open(metaPath(), FILE_READ_WRITE);
+        return static_cast<bool>(sessionData);
+    }
+
+
+    /**
+     * @brief Closes the session handles, flushing pending writes
+     */
+    void endSession() {
+        if (sessionData) sessionData.close();
+        if (sessionIndex) sessionIndex.close();
+        if (sessionMeta) sessionMeta.close();
+    }
+
+
+    /**
+     * @brief Path of the sidecar offset index
+     */
+    [[nodiscard]] String indexPath() const {
+        return filePath + ".idx";
+    }
+
+
+    /**
+     * @brief Byte position of an index entry inside the index file
+     */
+    static size_t indexEntryPos(const size_t entry) {
+        return sizeof(IndexHeader) + entry * sizeof(uint32_t);
+    }
+
+
+    /**
+     * @brief Writes the cached index header to the start of an open index file
+     */
+    bool writeIndexHeader(File& indexFile) const {
+        MEMORY_LIST_IO(seeks, 1);
+        MEMORY_LIST_IO(bytesWritten, sizeof(IndexHeader));
+        if (!indexFile.seek(0)) return false;
+        return indexFile.write(reinterpret_cast<const uint8_t*>(&indexHeader), sizeof(IndexHeader)) == sizeof(IndexHeader);
+    }
+
+
+    /**
+     * @brief Loads the index header and checks it against the data file
+     * @return true if the index exists and describes the current data file
+     * @details Rejects a bad magic number, a truncated entry table, a live count that differs
+     *          from currentSize and a data size that differs from the file on the card.
+     *          Bytes past the last entry are ignored, as erasing from the tail never truncates.
+     */
+    bool loadIndex() {
+        File indexFile = openIndexFile(FILE_READ);
+        if (!indexFile) return false;
+
+        IndexHeader header;
+        const bool readOk = indexFile.read(reinterpret_cast<uint8_t*>(&header), sizeof(IndexHeader)) == sizeof(IndexHeader);
+        const size_t indexSize = sizeOf(indexFile);
+        closeIndexFile(indexFile);
+
+        if (!readOk || header.magic != INDEX_MAGIC || header.first > header.count) return false;
+        if (indexSize < indexEntryPos(header.count)) return false;
+        if (header.count - header.first != currentSize) return false;
+
+        File dataFile = openDataFile(FILE_READ);
+        const size_t dataSize = sizeOf(dataFile);
+        closeDataFile(dataFile);
+        if (header.dataSize != dataSize) return false;
+
+        indexHeader = header;
+        return true;
+    }
+
+
+    /**
+     * @brief Regenerates the index from the data file
+     * @return true if successful, false on failure
+     * @details Single buffered pass over the data file recording the offset of every live record
+     */
+    bool rebuildIndex() {
+        File dataFile = openDataFile(FILE_READ);
+        File indexFile = openIndexFile(FILE_WRITE);
+        if (!dataFile || !indexFile) {
+            DEBUG_PRINT("Failed to open files for index rebuild!");
+            if (dataFile) closeDataFile(dataFile);
+            if (indexFile) closeIndexFile(indexFile);
+            return false;
+        }
+
+        indexHeader = IndexHeader();
+        indexHeader.dataSize = sizeOf(dataFile);
+
+        WriteBufferingStream writer(indexFile, 64);
+        writer.write(reinterpret_cast<const uint8_t*>(&indexHeader), sizeof(IndexHeader));
+        uint8_t buffer[BUFFER_SIZE];
+        walkRecords(dataFile, 0, buffer, sizeof(buffer), [&](const size_t recordOffset, size_t, const bool live) {
+            if (!live) return true;
+            const uint32_t offset = recordOffset;
+            writer.write(reinterpret_cast<const uint8_t*>(&offset), sizeof(offset));
+            indexHeader.count++;
+            return true;
+        });
+        writer.flush();
+        closeDataFile(dataFile);
+
+        const bool status = writeIndexHeader(indexFile);
+        closeIndexFile(indexFile);
+        return status;
+    }
+
+
+    /**
+     * @brief Reads consecutive record offsets from the index
+     * @param line_no Index of the first live record to look up
+     * @param count Number of offsets to read
+     * @param offsets Output array with room for count entries
+     * @return Number of offsets actually read
+     */
+    size_t readIndexEntries(const size_t line_no, const size_t count, size_t* offsets) const {
+        File indexFile = openIndexFile(FILE_READ);
+        if (!indexFile) {DEBUG_PRINT("Failed to open index for reading!"); return 0;}
+        MEMORY_LIST_IO(seeks, 1);
+        if (!indexFile.seek(indexEntryPos(indexHeader.first + line_no))) {closeIndexFile(indexFile); return 0;}
+
+        size_t read = 0;
+        for (uint32_t offset = 0; read < count; read++) {
+            if (indexFile.read(reinterpret_cast<uint8_t*>(&offset), sizeof(offset)) != sizeof(offset)) break;
+            offsets[read] = offset;
+        }
+        MEMORY_LIST_IO(bytesRead, read * sizeof(uint32_t));
+        closeIndexFile(indexFile);
+        return read;
+    }
+
+
+    /**
+     * @brief Opens the data file, and the index when enabled, for appending records
+     * @param dataFile Set to the data file handle
+     * @param indexFile Set to the index handle, positioned at the next free entry
+     * @param indexOk Cleared when the index could not be opened or positioned
+     * @return true if the data file is open
+     */
+    bool beginAppend(File& dataFile, File& indexFile, bool& indexOk) {
+        dataFile = openDataFile(FILE_APPEND);
+        if (!dataFile) return false;
+        markDirty();
+        if (config.useIndex) {
+            indexFile = openIndexFile(FILE_READ_WRITE);
+            MEMORY_LIST_IO(seeks, 1);
+            indexOk = indexFile && indexFile.seek(indexEntryPos(indexHeader.count));
+        }
+        return true;
+    }
+
+
+    /**
+     * @brief Closes the handles of beginAppend() and accounts for the records appended
+     * @param committed Number of records appended
+     * @param startOffset Data file size before the first of them
+     * @param offset Data file size after the last of them
+     * @param lastLength Raw length of the last of them
+     */
+    void endAppend(File& dataFile, File& indexFile, bool indexOk, const size_t committed,
+                   const size_t startOffset, const size_t offset, const size_t lastLength) {
+        closeDataFile(dataFile);
+        if (committed) setTail(offset - lastLength, lastLength);
+        currentSize += committed;
+        liveBytes += offset - startOffset;
+        if (config.useIndex) {
+            if (indexOk && committed) {
+                indexHeader.count += committed;
+                indexHeader.dataSize = offset;
+                indexOk = writeIndexHeader(indexFile);
+            }
+            if (indexFile) closeIndexFile(indexFile);
+            if (!indexOk) rebuildIndex();
+        }
+    }
+
+
+    /**
+     * @brief Appends records from the ingest ring in BUFFER_SIZE chunks
+     * @param keep Number of records to leave queued
+     * @return Number of records appended
+     * @details The ring's only consumer, so callers hold the list exclusively. The ring holds
+     *          bare payloads, framed here in the format of the file at the time of the drain. The records of a
+     *          chunk that fails to write are counted as overflows and draining stops there.
+     *          MessagePack payloads bound for a text file are converted to JSON, or counted
+     *          as overflows when the text does not fit a chunk.
+     */
+    size_t drainIngest(const size_t keep) {
+        if (!ingest.enabled() || ingest.size() <= keep) return 0;
+        flushWriteBack();
+        File dataFile;
+        File indexFile;
+        bool indexOk = true;
+        if (!beginAppend(dataFile, indexFile, indexOk)) {DEBUG_PRINT("Failed to open file for appending!"); return 0;}
+
+        const size_t startOffset = sizeOf(dataFile);
+        size_t offset = startOffset;
+        size_t committed = 0;
+        char chunk[BUFFER_SIZE];
+        size_t used = 0;
+        size_t queued = 0;           // records placed in chunk
+        size_t chunkLastLength = 0;  // length of the last record placed in chunk
+        size_t lastLength = 0;       // length of the last record committed
+        bool status = true;
+        const auto writeOut = [&] {
+            const size_t records = writeChunk(dataFile, indexFile, chunk, used, offset, currentSize + committed, indexOk);
+            if (records) {committed += records; offset += used; lastLength = chunkLastLength;}
+            else {ingestOverflows += queued; status = false;}
+            used = 0;
+            queued = 0;
+        };
+
+        // enqueue() packs records for a MessagePack list even while its file still holds text
+        const bool unpacking = config.encoding == RecordEncoding::MessagePack && !binaryRecords;
+        char text[BUFFER_SIZE];
+        size_t payload = 0;
+        const char* record = nullptr;
+        while (status && ingest.size() > keep && (record = ingest.front(payload))) {
+            if (unpacking) {
+                payload = unpackInto(record, payload, text, BUFFER_SIZE - 2);
+                if (!payload) {ingest.pop(); ingestOverflows++; continue;}
+                record = text;
+            }
+            const size_t length = recordLength(payload);
+            if (used + length > BUFFER_SIZE) {
+                writeOut();
+                if (!status) break;
+            }
+            memcpy(chunk + used + payloadOffset(), record, payload);
+            sealRecord(chunk + used, payload);
+            ingest.pop();
+            used += length;
+            queued++;
+            chunkLastLength = length;
+            maxRecordLength = max(maxRecordLength, length);
+            MEMORY_LIST_IO_MAX(largestRecord, length);
+        }
+        if (status && used) writeOut();
+        endAppend(dataFile, indexFile, indexOk, committed, startOffset, offset, lastLength);
+        return committed;
+    }
+
+
+    /**
+     * @brief Appends one record straight to the data file, the body of push() without write-back
+     * @param element JSON object to store
+     * @return true if successful, false on failure
+     */
+    bool appendRecord(const JsonObjectConst element) {
+        File dataFile = openDataFile(FILE_APPEND);
+        if (!dataFile) {DEBUG_PRINT("Failed to open file for appending!");return false;}
+        if (element.isNull()) {DEBUG_PRINT("Element is null!");return false;}
+
+        markDirty();
+        const size_t offset = sizeOf(dataFile);
+        const size_t written = push(element, dataFile);
+        closeDataFile(dataFile);
+
+        if (written) {setTail(offset, written); maxRecordLength = max(maxRecordLength, written); checkpointRecord(currentSize - 1, offset);}
+        if (written && config.useIndex && !appendIndexEntry(offset, offset + written)) rebuildIndex();
+        return written > 0;
+    }
+
+
+    /**
+     * @brief Adds a record to the write-back buffer, writing the buffer out first if it is full
+     * @param element JSON object to store
+     * @return true if the record is buffered or written, false on failure
+     * @details A record longer than the whole buffer is appended directly once the buffer
+     *          is written out, so it cannot overtake the records before it.
+     */
+    bool bufferRecord(const JsonObjectConst element) {
+        if (element.isNull()) {DEBUG_PRINT("Element is null!");return false;}
+        const size_t payload = measurePayload(element);
+        const size_t length = recordLength(payload);
+        if (writeBack.used + length > writeBack.capacity) {
+            flushWriteBack();
+            if (writeBack.records) return false;
+            if (length > writeBack.capacity) return appendRecord(element);
+        }
+
+        char* record = writeBack.buffer + writeBack.used;
+        serializePayload(element, record + payloadOffset(), writeBack.capacity - writeBack.used - payloadOffset());
+        sealRecord(record, payload);
+        if (writeBack.records == 0) writeBack.since = millis();
+        writeBack.used += length;
+        writeBack.records++;
+        writeBack.lastLength = length;
+        maxRecordLength = max(maxRecordLength, length);
+        MEMORY_LIST_IO_MAX(largestRecord, length);
+        if (writeBackDue()) flushWriteBack();
+        return true;
+    }
+
+
+    /** @brief Whether the oldest record of the write-back buffer has waited config.writeBackTimeout */
+    bool writeBackDue() const {
+        return writeBack.records && config.writeBackTimeout && millis() - writeBack.since >= config.writeBackTimeout;
+    }
+
+
+    /**
+     * @brief Writes the write-back buffer to the data file with one open and one write
+     * @return Number of records written; on failure the records stay buffered and 0 is returned
+     * @details Callers hold the list exclusively. The records are accounted for and indexed
+     *          here, like a pushBatch() chunk.
+     */
+    size_t flushWriteBack() {
+        if (writeBack.records == 0) return 0;
+        File dataFile;
+        File indexFile;
+        bool indexOk = true;
+        if (!beginAppend(dataFile, indexFile, indexOk)) {DEBUG_PRINT("Failed to open file for appending!"); return 0;}
+
+        const size_t startOffset = sizeOf(dataFile);
+        const size_t records = writeChunk(dataFile, indexFile, writeBack.buffer, writeBack.used, startOffset, currentSize, indexOk);
+        endAppend(dataFile, indexFile, indexOk, records, startOffset, startOffset + (records ? writeBack.used : 0), writeBack.lastLength);
+        if (!records) {DEBUG_PRINT("Failed to write buffered records, keeping them!"); return 0;}
+        writeBack.used = 0;
+        writeBack.records = 0;
+        return records;
+    }
+
+
+    /**
+     * @brief Writes out the write-back buffer before a read that reaches an index it may hold
+     * @param index Index about to be read, SIZE_MAX for reads that reach the tail
+     * @details For the const readers, which take the lock shared afterwards. Records only get
+     *          into the buffer through push(), which a const list cannot call, so the buffer
+     *          of a list that is really const is always empty and is never written to here.
+     */
+    void settleWriteBack(const size_t index = SIZE_MAX) const {
+        if (!writeBack.capacity) return;
+        const Guard guard = writeGuard();
+        if (writeBack.records && index >= currentSize) const_cast<BasicMemoryList*>(this)->flushWriteBack();
+    }
+
+
+    /**
+     * @brief Body of forEach(), for callers that hold the lock
+     */
+    template <typename Callback>
+    size_t visitRange(const size_t from, const size_t count, Callback&& callback) const {
+        if (count == 0 || from >= currentSize) return 0;
+        File dataFile = openDataFile(FILE_READ);
+        if (!dataFile) {DEBUG_PRINT("Failed to open file for reading!"); return 0;}
+
+        size_t start = 0;
+        size_t visited = 0;
+        if (locateLine(dataFile, from, start)) {
+            JsonDocument doc;
+            uint8_t buffer[BUFFER_SIZE];
+            uint8_t spare[BUFFER_SIZE];  // a record split across two windows is read again in one piece
+            walkRecords(dataFile, start, buffer, sizeof(buffer),
+                        [&](const size_t offset, const size_t length, const bool live, const uint8_t* bytes) {
+                if (!live) return true;
+                if (!bytes && length <= sizeof(spare)) {
+                    MEMORY_LIST_IO(seeks, 1);
+                    MEMORY_LIST_IO(bytesRead, length);
+                    if (dataFile.seek(offset) && dataFile.read(spare, length) == length) bytes = spare;
+                }
+                if (!(bytes ? parseRecord(bytes, length, doc) : deserializeAt(dataFile, offset, doc))) return false;
+                const bool more = callback(from + visited, static_cast<const JsonDocument&>(doc));
+                return ++visited < count && more;
+            });
+        }
+        closeDataFile(dataFile);
+        return visited;
+    }
+
+
+    /**
+     * @brief Writes a chunk of serialized records to the data file
+     * @param dataFile Open data file handle, positioned at the end
+     * @param indexFile Index handle positioned at the next free entry, closed when the index is off
+     * @param chunk Serialized records, framed by sealRecord()
+     * @param length Chunk length in bytes
+     * @param offset Byte offset of the chunk in the data file
+     * @param firstIndex List index the chunk's first record gets
+     * @param indexOk Cleared when an index entry could not be written
+     * @return Number of records written, 0 on failure
+     */
+    size_t writeChunk(File& dataFile, File& indexFile, const char* chunk, const size_t length,
+                      const size_t offset, const size_t firstIndex, bool& indexOk) {
+        if (length == 0) return 0;
+        MEMORY_LIST_IO(bytesWritten, length);
+        if (dataFile.write(reinterpret_cast<const uint8_t*>(chunk), length) != length) {
+            DEBUG_PRINT("Failed to write batch to file!");
+            return 0;
+        }
+
+        size_t records = 0;
+        for (size_t start = 0; start < length; records++) {
+            const uint32_t recordOffset = offset + start;
+            checkpointRecord(firstIndex + records, recordOffset);
+            if (indexFile && indexFile.write(reinterpret_cast<const uint8_t*>(&recordOffset), sizeof(recordOffset)) != sizeof(recordOffset)) indexOk = false;
+            MEMORY_LIST_IO(bytesWritten, indexFile ? sizeof(recordOffset) : 0);
+            if (binaryRecords) {
+                start += RECORD_HEADER_SIZE + decodeHeader(reinterpret_cast<const uint8_t*>(chunk + start)).length;
+                continue;
+            }
+            const auto* newline = static_cast<const char*>(memchr(chunk + start, '\n', length - start));
+            start = newline ? newline - chunk + 1 : length;
+        }
+        return records;
+    }
+
+
+    /**
+     * @brief Appends the offset of a freshly pushed record to the index
+     * @param offset Byte offset of the new record
+     * @param dataSize Size of the data file after the append
+     * @return true if successful, false on failure
+     */
+    bool appendIndexEntry(const size_t offset, const size_t dataSize) {
+        File indexFile = openIndexFile(FILE_READ_WRITE);
+        if (!indexFile) {DEBUG_PRINT("Failed to open index for writing!"); return false;}
+
+        const uint32_t value = offset;
+        MEMORY_LIST_IO(seeks, 1);
+        MEMORY_LIST_IO(bytesWritten, sizeof(value));
+        bool status = indexFile.seek(indexEntryPos(indexHeader.count)) &&
+                      indexFile.write(reinterpret_cast<const uint8_t*>(&value), sizeof(value)) == sizeof(value);
+        if (status) {
+            indexHeader.count++;
+            indexHeader.dataSize = dataSize;
+            status = writeIndexHeader(indexFile);
+        }
+        closeIndexFile(indexFile);
+        return status;
+    }
+
+
+    /**
+     * @brief Moves a run of index entries inside the index file
+     * @param indexFile Open index file handle
+     * @param from First entry to move
+     * @param to Destination of the first entry
+     * @param count Number of entries to move
+     * @return true if successful, false on failure
+     * @details Overlap-safe (memmove semantics), copies through a BUFFER_SIZE stack buffer
+     */
+    bool moveIndexEntries(File& indexFile, const size_t from, const size_t to, const size_t count) const {
+        constexpr size_t chunkEntries = BUFFER_SIZE / sizeof(uint32_t);
+        uint8_t buffer[BUFFER_SIZE];
+        const bool ascending = to < from;
+
+        for (size_t done = 0; done < count;) {
+            const size_t chunk = min(chunkEntries, count - done);
+            const size_t start = ascending ? done : count - done - chunk;
+            const size_t bytes = chunk * sizeof(uint32_t);
+            MEMORY_LIST_IO(seeks, 2);
+            MEMORY_LIST_IO(bytesRead, bytes);
+            MEMORY_LIST_IO(bytesWritten, bytes);
+            if (!indexFile.seek(indexEntryPos(from + start)) || indexFile.read(buffer, bytes) != bytes) return false;
+            if (!indexFile.seek(indexEntryPos(to + start)) || indexFile.write(buffer, bytes) != bytes) return false;
+            done += chunk;
+        }
+        return true;
+    }
+
+
+    /**
+     * @brief Removes one live record from the index
+     * @param line_no Index of the removed record
+     * @return true if successful, false on failure
+     * @details Shifts whichever side of the entry is shorter, so removals near either end are cheap
+     */
+    bool eraseIndexEntry(const size_t line_no) {
+        File indexFile = openIndexFile(FILE_READ_WRITE);
+        if (!indexFile) {DEBUG_PRINT("Failed to open index for writing!"); return false;}
+
+        const size_t entry = indexHeader.first + line_no;
+        bool status;
+        if (entry - indexHeader.first < indexHeader.count - entry) {
+            status = moveIndexEntries(indexFile, indexHeader.first, indexHeader.first + 1, line_no);
+            indexHeader.first++;
+        } else {
+            status = moveIndexEntries(indexFile, entry + 1, entry, indexHeader.count - entry - 1);
+            indexHeader.count--;
+        }
+        status = status && writeIndexHeader(indexFile);
+        closeIndexFile(indexFile);
+        return status;
+    }
+
+
+    /**
+     * @brief Removes a set of live records from the index in one pass
+     * @param lines Indices of the removed records, ascending and unique
+     * @param count Number of removed records
+     * @return true if successful, false on failure
+     * @details A leading run 0, 1, 2... only advances the first entry. The entries after the
+     *          other removed records close each gap with one move, so every entry moves at most once.
+     */
+    bool eraseIndexEntries(const size_t* lines, const size_t count) {
+        File indexFile = openIndexFile(FILE_READ_WRITE);
+        if (!indexFile) {DEBUG_PRINT("Failed to open index for writing!"); return false;}
+
+        size_t prefix = 0;
+        while (prefix < count && lines[prefix] == prefix) prefix++;
+        bool status = true;
+        for (size_t k = prefix; status && k < count; k++) {
+            const size_t from = indexHeader.first + lines[k] + 1;
+            const size_t to = k + 1 < count ? indexHeader.first + lines[k + 1] : indexHeader.count;
+            status = moveIndexEntries(indexFile, from, from - (k - prefix + 1), to - from);
+        }
+        indexHeader.first += prefix;
+        indexHeader.count -= count - prefix;
+        status = status && writeIndexHeader(indexFile);
+        closeIndexFile(indexFile);
+        return status;
+    }
+
 
-class MemoryList {
-private:
-    /** @brief Path to the storage file on SD card */
-    String filePath;
+    /**
+     * @brief Drops the first n live records from the index
+     * @param count Number of records removed from the head
+     * @return true if successful, false on failure
+     */
+    bool dropIndexEntries(const size_t count) {
+        File indexFile = openIndexFile(FILE_READ_WRITE);
+        if (!indexFile) {DEBUG_PRINT("Failed to open index for writing!"); return false;}
+        indexHeader.first += count;
+        const bool status = writeIndexHeader(indexFile);
+        closeIndexFile(indexFile);
+        return status;
+    }
 
-    /** @brief Current number of valid entries in the list */
-    size_t currentSize;
+    /**
+     * @brief Body of removeMany() once the indices are sorted, unique and in range
+     * @param targets Indices of the records to remove, ascending
+     * @param count Number of indices
+     * @return Number of records tombstoned
+     * @details Works front to back through one read/write handle: each record is found by
+     *          scanning on from the end of the one before, or from a checkpoint past it, or
+     *          through the index, and is tombstoned right away. Every scan starts where the last
+     *          one stopped, so the file is read once at most. Counters, index and checkpoints are
+     *          updated once at the end, for the records tombstoned before any failure.
+     */
+    size_t tombstoneMany(const size_t* targets, const size_t count) {
+        File dataFile = openDataFile(FILE_READ_WRITE);
+        if (!dataFile) {DEBUG_PRINT("Failed to open file for writing!"); return 0;}
+        markDirty();
+
+        size_t cursor = headOffset;  // the first live record at or after it has index cursorIndex
+        size_t cursorIndex = 0;
+        size_t removed = 0;
+        size_t removedBytes = 0;
+        for (; removed < count; removed++) {
+            const size_t index = targets[removed];
+            size_t offset = 0;
+            size_t lineLength = 0;
+            if (config.useIndex) {
+                if (readIndexEntries(index, 1, &offset) != 1) break;
+                lineLength = lineLengthAt(dataFile, offset);
+            } else {
+                const size_t nearest = checkpointsUpTo(index);
+                if (nearest && checkpoints[nearest - 1].index > cursorIndex) {
+                    cursor = checkpoints[nearest - 1].offset;
+                    cursorIndex = checkpoints[nearest - 1].index;
+                }
+                if (!scanForLine(dataFile, cursor, index - cursorIndex, offset, &lineLength)) break;
+            }
+            MEMORY_LIST_IO(seeks, 1);
+            MEMORY_LIST_IO(bytesWritten, 1);
+            if (lineLength == 0 || !dataFile.seek(offset, SeekSet) || dataFile.write(tombstoneByte()) != 1) break;
+            removedBytes += lineLength;
+            if (index == removed) headOffset = offset + lineLength;  // every record before it is gone too
+            cursor = offset + lineLength;
+            cursorIndex = index + 1;
+        }
+        closeDataFile(dataFile);
+        if (removed < count) DEBUG_PRINT("Failed to remove element!");
+        settleRemoved(targets, removed, removedBytes);
+        return removed;
+    }
 
-    /** @brief Buffer size optimized for ESP32 SD card operations */
-    static constexpr size_t BUFFER_SIZE = 512;  // ESP32 friendly buffer size
-    /** @brief Character used to mark deleted entries */
-    static constexpr char TOMBSTONE = '$';      // Marker for deleted entries
-    /** @brief Threshold ratio that triggers automatic defragmentation */
-    static constexpr float DEFRAG_THRESHOLD = 0.6f; // 60% fragmentation triggers defrag
+
+    /**
+     * @brief Updates counters, checkpoints, mirror and index after records were tombstoned
+     * @param targets Indices the removed records had, ascending
+     * @param count Number of records removed
+     * @param removedBytes Their raw lengths added up
+     * @details headOffset is the caller's to move, it knows where the records were.
+     */
+    void settleRemoved(const size_t* targets, const size_t count, const size_t removedBytes) {
+        if (count == 0) return;
+        if (targets[count - 1] == currentSize - 1) tailKnown = false;
+        currentSize -= count;
+        accountRemoved(removedBytes);
+        shiftCheckpoints([&, next = static_cast<size_t>(0)](const size_t index) mutable {
+            while (next < count && targets[next] < index) next++;
+            return next;
+        });
+        for (size_t k = count; k-- > 0;) mirrorRemove(targets[k]);
+        if (config.useIndex && !eraseIndexEntries(targets, count)) rebuildIndex();
+    }
 
 
     /**
-     * @brief Internal method to push JSON object to file
-     * @param element JSON object to store
-     * @param file Open file handle
-     * @return true if successful, false otherwise
-     * @details Handles serialization and writing of JSON objects with error checking
+     * @brief Body of removeIf(), for callers that hold the lock
+     * @details Walks every record from the head through one read/write handle and tombstones
+     *          each match before moving on. The indices of the matches are kept in a heap array
+     *          grown by doubling, for settleRemoved() at the end.
      */
-    bool push(const JsonObjectConst element, File file) {
-        if (!file) {DEBUG_PRINT("File not opened by SD!");return false;}
-        if (element.isNull()) {DEBUG_PRINT("Element is null!");return false;}
-    
-        String element_string;
-        serializeJson(element, element_string);
-        element_string.trim();
-    
-        if (file.println(element_string)) {currentSize++; return true;}
-        DEBUG_PRINT("Failed to write element to file!");
-        return false;
+    template <typename Predicate>
+    size_t tombstoneWhere(Predicate& predicate) {
+        if (currentSize == 0) return 0;
+        File dataFile = openDataFile(FILE_READ_WRITE);
+        if (!dataFile) {DEBUG_PRINT("Failed to open file for writing!"); return 0;}
+
+        size_t* targets = nullptr;
+        size_t capacity = 0;
+        size_t removed = 0;
+        size_t removedBytes = 0;
+        size_t index = 0;
+        bool failed = false;
+        JsonDocument doc;
+        uint8_t buffer[BUFFER_SIZE];
+        uint8_t spare[BUFFER_SIZE];  // a record split across two windows is read again in one piece
+        walkRecords(dataFile, headOffset, buffer, sizeof(buffer),
+                    [&](const size_t offset, const size_t length, const bool live, const uint8_t* bytes) {
+            if (!live) return true;
+            uint8_t* large = nullptr;  // a record longer than spare, only read whole for a raw predicate
+            if (!bytes && length <= sizeof(spare)) {
+                MEMORY_LIST_IO(seeks, 1);
+                MEMORY_LIST_IO(bytesRead, length);
+                if (dataFile.seek(offset) && dataFile.read(spare, length) == length) bytes = spare;
+            }
+            bool match = false;
+            if constexpr (std::is_invocable_r_v<bool, Predicate&, const JsonDocument&>) {
+                if (!(bytes ? parseRecord(bytes, length, doc) : deserializeAt(dataFile, offset, doc))) {failed = true; return false;}
+                match = predicate(static_cast<const JsonDocument&>(doc));
+            } else {
+                if (!bytes) {
+                    large = static_cast<uint8_t*>(malloc(length));
+                    MEMORY_LIST_IO(seeks, 1);
+                    MEMORY_LIST_IO(bytesRead, length);
+                    if (!large || !dataFile.seek(offset) || dataFile.read(large, length) != length) {
+                        free(large);
+                        failed = true;
+                        return false;
+                    }
+                    bytes = large;
+                }
+                size_t payload = binaryRecords ? decodeHeader(bytes).length : length;
+                while (!binaryRecords && payload > 0 && (bytes[payload - 1] == '\n' || bytes[payload - 1] == '\r')) payload--;
+                match = predicate(reinterpret_cast<const char*>(bytes + payloadOffset()), payload);
+                free(large);
+            }
+            if (match) {
+                if (removed == capacity) {
+                    const size_t grown = capacity ? capacity * 2 : 16;
+                    auto* larger = static_cast<size_t*>(realloc(targets, grown * sizeof(size_t)));
+                    if (!larger) {failed = true; return false;}
+                    targets = larger;
+                    capacity = grown;
+                }
+                if (removed == 0) markDirty();
+                MEMORY_LIST_IO(seeks, 1);
+                MEMORY_LIST_IO(bytesWritten, 1);
+                if (!dataFile.seek(offset, SeekSet) || dataFile.write(tombstoneByte()) != 1) {failed = true; return false;}
+                if (index == removed) headOffset = offset + length;  // every record before it is gone too
+                targets[removed++] = index;
+                removedBytes += length;
+            }
+            return ++index < currentSize;
+        });
+        closeDataFile(dataFile);
+        if (failed) DEBUG_PRINT("Failed to remove matching elements!");
+        settleRemoved(targets, removed, removedBytes);
+        free(targets);
+        return removed;
     }
 
 
     /**
-     * @brief Validates and ensures file existence
-     * @return true if file exists or was created successfully
-     * @details Creates file if it doesn't exist, performs error checking
+     * @brief Body of sync(), for callers that hold the lock or own the list alone
      */
-    [[nodiscard]] bool checkFile() const {
-        if (!SD.exists(filePath)) {
-            File dataFile = SD.open(filePath, FILE_WRITE);
-            if (!dataFile) {DEBUG_PRINT("Failed to create file!"); return false;}
-            dataFile.close();
-        }
-        return true;
+    void flushPending() {
+        flushWriteBack();
+        drainIngest(0);
+        if (sessionData) {sessionData.flush(); MEMORY_LIST_IO(flushes, 1);}
+        if (sessionIndex) {sessionIndex.flush(); MEMORY_LIST_IO(flushes, 1);}
+        if (config.persistState && !stateClean) saveState(true);
     }
 
 
     /**
-     * @brief Reads a line from specific position in file
-     * @param cursor_pos Starting position in file
-     * @param file Open file handle
-     * @return String containing the line read
-     * @details Handles boundary conditions and EOF
+     * @brief Body of defragment(), for callers that hold the lock
+     * @details Runs a whole compaction in one go, with nothing to reclaim there is nothing to do
+     */
+    bool compactAll() {
+        abortCompaction();
+        if (liveBytes + deadBytes == 0) {DEBUG_PRINT("File is empty, no need to defragment"); return true;}
+        if (deadBytes == 0) return true;
+#ifdef MEMORY_LIST_IO_STATS
+        const unsigned long started = micros();
+#endif
+
+        bool done = false;
+        const bool status = beginCompaction() && copyRecords(SIZE_MAX, 0, done) && done && finishCompaction();
+        if (!status) abortCompaction();
+        MEMORY_LIST_IO(defragmentMicros, micros() - started);
+        if (status) DEBUG_PRINT("Defragmentation complete. Valid entries: " + String(currentSize));
+        return status;
+    }
+
+
+    /**
+     * @brief Body of defragmentStep(), for callers that hold the lock
+     */
+    bool compactStep(const size_t byteBudget, const unsigned long microsBudget) {
+        if (!compaction.active && !beginCompaction()) return false;
+#ifdef MEMORY_LIST_IO_STATS
+        const unsigned long started = micros();
+#endif
+        bool done = false;
+        const bool copied = copyRecords(byteBudget, microsBudget, done);
+        if (copied && done) finishCompaction();
+        MEMORY_LIST_IO(defragmentMicros, micros() - started);
+        return copied && !done;
+    }
+
+
+    /**
+     * @brief Body of readLine(), for callers that hold the lock
      */
-    static String readLineFromPos(const size_t cursor_pos, File file) {
-        file.seek(cursor_pos);
-        if(file.available()){
-            String str = file.readStringUntil('\n');
-            str.trim(); 
-            return str;
+    [[nodiscard]] String readLineAt(const size_t line_no, size_t* cursorPosition = nullptr, size_t* lineLength = nullptr) const {
+        File dataFile = openDataFile(FILE_READ);
+        if (!dataFile) { DEBUG_PRINT("Failed to open file for reading!"); return "";}
+
+        size_t offset = 0;
+        if (!locateLine(dataFile, line_no, offset)) {closeDataFile(dataFile); return "";}
+        String line = readLineFromPos(offset, dataFile, lineLength);
+        closeDataFile(dataFile);
+        if (cursorPosition) *cursorPosition = offset;
+        return line;
+    }
+
+
+    /**
+     * @brief Body of getFragmentationRatio(), for callers that hold the lock
+     */
+    [[nodiscard]] float fragmentationRatio() const {
+        const size_t rawFileSize = liveBytes + deadBytes;
+        if (rawFileSize == 0) return 0.0f;
+        return static_cast<float>(deadBytes) / static_cast<float>(rawFileSize);
+    }
+
+
+    /**
+     * @brief Body of shouldDefragment(), for callers that hold the lock
+     */
+    bool defragmentDue(const float threshold = 0.7f) const {
+        const float fragRatio = fragmentationRatio();
+        if (fragRatio >= threshold) {
+            DEBUG_PRINT("Fragmentation ratio " + String(fragRatio * 100) + "% exceeds threshold " + String(threshold * 100) + "%");
+            return true;
         }
-        return "";
+        return false;
     }
 
+
 public:
     /**
      * @brief Constructor
      * @param filePath Path to storage file on SD card
+     * @param config Optional features, see MemoryListConfig
      * @throws Runtime error if SD card initialization fails
-     * @details Initializes SD card, creates/opens storage file, validates content
+     * @details Initializes SD card, creates/opens storage file, validates content.
+     *          With config.useIndex a missing, stale or corrupt index is rebuilt here.
+     *          With config.checkpointInterval or config.checkpointBudget the construction scan
+     *          fills the checkpoint table, allocated here under a budget; a start from saved
+     *          state fills it with one pass of its own.
+     *          With config.persistState the state is saved as clean here; without it a
+     *          leftover metadata file is removed, as the list will not keep it current.
+     *          With config.keepOpen the session handles are opened last, followed by the
+     *          ingest ring, the write-back buffer and the list's task with config.ingestSlots,
+     *          config.writeBackSize or config.backgroundCompaction.
      */
-    explicit MemoryList(const String& filePath) :
-        filePath(filePath)
+    explicit BasicMemoryList(const String& filePath, const MemoryListConfig& config = MemoryListConfig()) :
+        filePath(filePath),
+        config(config)
     {
         if (!SD.begin()) {DEBUG_PRINT("SD card initialization failed!"); return;}
         if (!checkFile()) return;
         // if (!is_file_valid()) if(!fix_file()) {DEBUG_PRINT("FILE NOT VALID AND COULD NOT BE FIXED"); return;}
-        this->currentSize =  calcSize();
+        if (this->config.checkpointBudget) {
+            const size_t capacity = this->config.checkpointBudget / sizeof(Checkpoint);
+            checkpoints = capacity ? static_cast<Checkpoint*>(malloc(capacity * sizeof(Checkpoint))) : nullptr;
+            if (checkpoints) checkpointCapacity = capacity;
+            else {DEBUG_PRINT("Failed to allocate the checkpoint budget, checkpoints disabled!"); this->config.checkpointBudget = 0; this->config.checkpointInterval = 0;}
+        }
+        checkpointStride = initialStride();
+        seedCounters();
+        if (this->config.useIndex && !loadIndex()) {
+            DEBUG_PRINT("Index missing or stale, rebuilding");
+            if (!rebuildIndex()) {DEBUG_PRINT("Index rebuild failed, index disabled!"); this->config.useIndex = false;}
+        }
+        if (checkpointCount == 0) rebuildCheckpoints();
+        if (!this->config.persistState) {
+            if (SD.exists(metaPath())) SD.remove(metaPath());
+        } else if (!stateClean && !saveState(true)) {
+            DEBUG_PRINT("Metadata file not writable, state persistence disabled!");
+            this->config.persistState = false;
+        }
+        if (this->config.keepOpen && !beginSession()) {
+            DEBUG_PRINT("Failed to open session, falling back to open per call!");
+            endSession();
+            this->config.keepOpen = false;
+        }
+        if (this->config.ingestSlots) {
+            this->config.ingestSlotSize = min(this->config.ingestSlotSize, BUFFER_SIZE - RECORD_HEADER_SIZE);
+            if (!ingest.begin(this->config.ingestSlots, this->config.ingestSlotSize)) {
+                DEBUG_PRINT("Failed to allocate the ingest ring, enqueue() disabled!");
+                this->config.ingestSlots = 0;
+            } else {
+                // A watermark the ring cannot reach would never wake the task
+                this->config.ingestHighWatermark = min(this->config.ingestHighWatermark, ingest.capacity());
+                this->config.ingestLowWatermark = min(this->config.ingestLowWatermark, max(this->config.ingestHighWatermark, static_cast<size_t>(1)) - 1);
+            }
+        }
+        if (this->config.writeBackSize) {
+            const size_t capacity = (this->config.writeBackSize + SECTOR_SIZE - 1) / SECTOR_SIZE * SECTOR_SIZE;
+            writeBack.buffer = static_cast<char*>(malloc(capacity));
+            if (writeBack.buffer) writeBack.capacity = capacity;
+            else {DEBUG_PRINT("Failed to allocate the write-back buffer, writing every push!"); this->config.writeBackSize = 0;}
+        }
+        if (usesWorker()) {
+            if (startWorker()) {
+                // Only background compaction picks up a fragmented file at boot
+                if (this->config.backgroundCompaction) {
+                    const Guard guard = writeGuard();
+                    defragmentIfDue();
+                }
+            } else {
+                DEBUG_PRINT("Failed to start the list's task, compacting in the foreground!");
+                this->config.backgroundCompaction = false;
+                this->config.ingestSlots = 0;
+            }
+        }
     }
     
 
     /**
-     * @brief Default destructor
+     * @brief Destructor
+     * @details Stops the list's task, syncs (writing the write-back buffer and draining the
+     *          ingest ring), then closes the session handles, if any
+     */
+    ~BasicMemoryList() {
+        stopWorker();
+        flushPending();
+        endSession();
+        free(writeBack.buffer);
+        free(checkpoints);
+    }
+
+
+    /**
+     * @brief Flushes the write-back buffer, the ingest ring and pending writes held by the session handles
+     * @details In open-per-call mode every operation closes, and therefore flushes, its own
+     *          handle. With config.persistState the state is then saved as clean, so a reset
+     *          after sync() reopens without a scan.
      */
-    ~MemoryList() =default;
+    void sync() {
+        const Guard guard = writeGuard();
+        flushPending();
+    }
 
 
     /**
      * @brief Returns statistics about the list
      * @return JsonDocument containing:
-     *         - size: current number of valid entries
+     *         - size: current number of valid entries, the write-back buffer's included
      *         - fragmentation: current fragmentation ratio
      *         - fileSize: total file size in bytes
+     *         - liveBytes: bytes held by valid entries
+     *         - deadBytes: bytes held by tombstoned entries
+     *         - maxRecordLength: upper bound on any entry's length including its line ending,
+     *           so a buffer of maxRecordLength + 1 bytes fits every get(index, buffer, size)
+     *           of a JSON payload; MessagePack payloads grow when converted to JSON text
+     *         - with config.writeBackSize: writeBackBytes, bytes waiting in the write-back buffer;
+     *           fileSize, liveBytes and deadBytes only count what is in the file
+     *         - with config.checkpointInterval or config.checkpointBudget: checkpoints, entries of
+     *           the RAM checkpoint table, and checkpointInterval, live records between them now
+     *         - with config.ingestSlots: ingestQueued, records waiting in the ingest ring, and
+     *           ingestOverflows, enqueue() calls refused or lost since construction
+     *         - with MEMORY_LIST_IO_STATS, totals since construction: opens, seeks, bytesRead,
+     *           bytesWritten, flushes, defragmentRuns, defragmentMicros and largestRecord
+     *           (longest record ever pushed or found, line ending included)
+     * @details Constant time, built from counters maintained by every mutation
      */
     [[nodiscard]] JsonDocument getStats() const {
+        const Guard guard = readGuard();
         JsonDocument stats;
-        stats["size"] = currentSize;
-        stats["fragmentation"] = getFragmentationRatio();
-        stats["fileSize"] = SD.open(filePath).size();
+        stats["size"] = currentSize + writeBack.records;
+        stats["fragmentation"] = fragmentationRatio();
+        stats["fileSize"] = liveBytes + deadBytes;
+        stats["liveBytes"] = liveBytes;
+        stats["deadBytes"] = deadBytes;
+        stats["maxRecordLength"] = maxRecordLength;
+        if (writeBack.capacity) stats["writeBackBytes"] = writeBack.used;
+        if (checkpointStride) {
+            stats["checkpoints"] = checkpointCount;
+            stats["checkpointInterval"] = checkpointStride;
+        }
+        if (config.ingestSlots) {
+            stats["ingestQueued"] = ingest.size();
+            stats["ingestOverflows"] = ingestOverflows.load();
+        }
+#ifdef MEMORY_LIST_IO_STATS
+        stats["opens"] = ioStats.opens.load();
+        stats["seeks"] = ioStats.seeks.load();
+        stats["bytesRead"] = ioStats.bytesRead.load();
+        stats["bytesWritten"] = ioStats.bytesWritten.load();
+        stats["flushes"] = ioStats.flushes.load();
+        stats["defragmentRuns"] = ioStats.defragmentRuns.load();
+        stats["defragmentMicros"] = ioStats.defragmentMicros.load();
+        stats["largestRecord"] = ioStats.largestRecord.load();
+#endif
         return stats;
     }
 
@@ -141,16 +2814,18 @@ public:
      * @details Counts non-tombstone entries in file
      */
     [[nodiscard]] size_t calcSize() const {
-        File dataFile = SD.open(filePath, FILE_READ);
+        settleWriteBack();
+        const Guard guard = readGuard();
+        File dataFile = openDataFile(FILE_READ);
         if (!dataFile) {DEBUG_PRINT("Failed to open file for reading!"); return 0;}
 
         size_t size = 0;
-        ReadBufferingStream reader(dataFile, 64); 
-        while (reader.available()) {
-            const String line = reader.readStringUntil('\n');
-            if (line.length()>0 && line[0] != TOMBSTONE) ++size;
-        }
-        dataFile.close();
+        uint8_t buffer[BUFFER_SIZE];
+        walkRecords(dataFile, 0, buffer, sizeof(buffer), [&](size_t, size_t, const bool live) {
+            if (live) ++size;
+            return true;
+        });
+        closeDataFile(dataFile);
         return size;
     }
 
@@ -163,15 +2838,131 @@ public:
      * @details Opens the file in append mode, serializes the JSON object,
      *          and writes it to the end of the file. Updates currentSize on success.
      *          Handles file opening errors and null element validation.
+     *          Records the new offset in the index when enabled.
+     *          With config.writeBackSize the record is collected in RAM instead and reaches the
+     *          card when the buffer fills, after config.writeBackTimeout, on flush() or sync(),
+     *          or before a read that reaches it. Until then a reset loses it.
      */
     bool push(const JsonObjectConst element) {
-        File dataFile = SD.open(filePath, FILE_APPEND);
-        if (!dataFile) {DEBUG_PRINT("Failed to open file for appending!");return false;}
-        if (element.isNull()) {DEBUG_PRINT("Element is null!");return false;}
+        const Guard guard = writeGuard();
+        return writeBack.capacity ? bufferRecord(element) : appendRecord(element);
+    }
 
-        const bool status = push(element, dataFile);
-        dataFile.close();
-        return status;
+
+    /**
+     * @brief Adds many JSON objects to the list with a single open and flush
+     * @param elements Array of JSON objects to add, in order
+     * @return Number of elements committed to the file
+     * @throws None
+     * @details Records are serialized back to back into a BUFFER_SIZE stack buffer which is
+     *          written out whenever the next record would not fit, so the card sees a few large
+     *          writes instead of one open/write/close per record. Records larger than the buffer
+     *          are streamed to the file like push() does. Stops at the first null element or failed write;
+     *          the elements before it stay committed. The index, when enabled, is opened once and
+     *          extended in the same pass.
+     */
+    size_t pushBatch(const JsonArrayConst elements) {
+        const Guard guard = writeGuard();
+        if (elements.isNull()) {DEBUG_PRINT("Elements are null!");return 0;}
+        flushWriteBack();
+        File dataFile;
+        File indexFile;
+        bool indexOk = true;
+        if (!beginAppend(dataFile, indexFile, indexOk)) {DEBUG_PRINT("Failed to open file for appending!");return 0;}
+
+        const size_t startOffset = sizeOf(dataFile);
+        size_t offset = startOffset;
+        size_t committed = 0;
+        char chunk[BUFFER_SIZE];
+        size_t used = 0;
+        size_t chunkLastLength = 0;  // length of the last record placed in chunk
+        size_t lastLength = 0;       // length of the last record committed
+        bool status = true;
+
+        for (const JsonVariantConst value : elements) {
+            const JsonObjectConst element = value.as<JsonObjectConst>();
+            if (element.isNull()) {DEBUG_PRINT("Element is null!"); break;}
+            const size_t payload = measurePayload(element);
+            const size_t length = recordLength(payload);
+
+            if (used + length > BUFFER_SIZE) {
+                const size_t records = writeChunk(dataFile, indexFile, chunk, used, offset, currentSize + committed, indexOk);
+                if (used && !records) {status = false; break;}
+                if (records) lastLength = chunkLastLength;
+                committed += records;
+                offset += used;
+                used = 0;
+            }
+
+            if (length > BUFFER_SIZE) {
+                const uint32_t recordOffset = offset;
+                const size_t written = writeRecord(element, dataFile);
+                if (written != length) {status = false; break;}
+                if (indexFile && indexFile.write(reinterpret_cast<const uint8_t*>(&recordOffset), sizeof(recordOffset)) != sizeof(recordOffset)) indexOk = false;
+                MEMORY_LIST_IO(bytesWritten, indexFile ? sizeof(recordOffset) : 0);
+                checkpointRecord(currentSize + committed, recordOffset);
+                committed++;
+                offset += written;
+                lastLength = written;
+                maxRecordLength = max(maxRecordLength, written);
+                continue;
+            }
+
+            serializePayload(element, chunk + used + payloadOffset(), BUFFER_SIZE - used - payloadOffset());
+            sealRecord(chunk + used, payload);
+            used += length;
+            chunkLastLength = length;
+            maxRecordLength = max(maxRecordLength, length);
+            MEMORY_LIST_IO_MAX(largestRecord, length);
+        }
+        if (status && used) {
+            const size_t records = writeChunk(dataFile, indexFile, chunk, used, offset, currentSize + committed, indexOk);
+            if (records) {committed += records; offset += used; lastLength = chunkLastLength;}
+        }
+        endAppend(dataFile, indexFile, indexOk, committed, startOffset, offset, lastLength);
+        return committed;
+    }
+
+
+    /**
+     * @brief Queues a JSON object for the file without blocking
+     * @param element The JSON object to add
+     * @return true if queued, false if the ring is full, the record is longer than a slot or
+     *         there is no ring; the first two count as overflows in getStats()
+     * @throws None
+     * @details Lock-free and safe to call from any task, also while another task uses the list.
+     *          The record reaches the file after every record queued before it, when the list's
+     *          task drains the ring at config.ingestHighWatermark, or on flush(), sync() or
+     *          destruction. Until then size() does not count it and get() cannot return it.
+     *          Records written with push() go straight to the file and may overtake it.
+     */
+    bool enqueue(const JsonObjectConst element) {
+        if (!config.ingestSlots) {DEBUG_PRINT("Ingest ring disabled!"); return false;}
+        if (element.isNull()) {DEBUG_PRINT("Element is null!"); return false;}
+        // Encoded by the config alone: the file's format may only be read under the lock
+        const bool packed = config.encoding == RecordEncoding::MessagePack;
+        const size_t length = packed ? measureMsgPack(element) : measureJson(element);
+        const bool queued = ingest.emplace(length, [&](char* slot) {
+            packed ? serializeMsgPack(element, slot, length) : serializeJson(element, slot, length);
+        });
+        if (!queued) {ingestOverflows++; return false;}
+        if (config.ingestHighWatermark && ingest.size() >= config.ingestHighWatermark) xTaskNotify(workerTask, WORKER_DRAIN, eSetBits);
+        return true;
+    }
+
+
+    /**
+     * @brief Writes the write-back buffer and drains the ingest ring into the file
+     * @return Number of records appended
+     * @throws None
+     * @details Writes the records collected by push() in one go, then appends every queued
+     *          record in BUFFER_SIZE chunks, with one open and close of the data file each.
+     *          Call sync() as well to flush session handles and saved state.
+     */
+    size_t flush() {
+        const Guard guard = writeGuard();
+        const size_t written = flushWriteBack();
+        return written + drainIngest(0);
     }
 
 
@@ -182,7 +2973,8 @@ public:
      * @details Fast operation that checks currentSize without file access
      */
     [[nodiscard]] bool isEmpty() const {
-        return currentSize == 0;
+        const Guard guard = readGuard();
+        return currentSize == 0 && writeBack.records == 0;
     }
 
 
@@ -190,50 +2982,70 @@ public:
      * @brief Retrieves the last valid element in the list
      * @return String containing the last valid JSON object, empty string on failure
      * @throws None
-     * @details Implements a sophisticated buffer-aware backward search algorithm:
+     * @details Served with one seek and one read from the cached tail offset, which push,
+     *          pushBatch and defragment keep current. When the tail is unknown (e.g. right
+     *          after removing the last element) a buffer-aware backward search finds it:
      *          - Handles buffer boundaries
      *          - Skips tombstone entries
-     *          - Uses efficient buffered reading
-     *          - Handles newline characters at buffer boundaries
-     *          - Manages file position tracking
+     *          - Stops at the head offset
+     *          - Caches the result for the next call
      */
     [[nodiscard]] String getLast() const {
-        if (isEmpty()) {DEBUG_PRINT("List is empty!");return ""; }
-        File dataFile = SD.open(filePath, FILE_READ);
+        settleWriteBack();
+        const Guard guard = readGuard();
+        if (currentSize == 0) {DEBUG_PRINT("List is empty!");return ""; }
+        File dataFile = openDataFile(FILE_READ);
         if (!dataFile) {DEBUG_PRINT("Failed to open file for reading!"); return "";}
 
+        size_t offset = 0;
+        const String val = locateLast(dataFile, offset) ? readLineFromPos(offset, dataFile) : String();
+        if (val.isEmpty()) DEBUG_PRINT("Failed to get last element!");
+        closeDataFile(dataFile);
+        return val;
+    }
 
-        const size_t fileSize = dataFile.size();
-
-        for (size_t pos = fileSize; pos > 0;) {
-            constexpr size_t bufferSize = 512;
-            uint8_t buffer[bufferSize];
 
-            const size_t readSize = min(bufferSize, pos);
-            pos -= readSize;
-            if(!dataFile.seek(pos)){dataFile.close(); DEBUG_PRINT(pos, "Failed to seek to position"); return "";}
-            const size_t bytesRead = dataFile.read(buffer, readSize);
+    /**
+     * @brief Copies the last valid element into a caller-provided buffer
+     * @param buffer Destination, NUL-terminated on success
+     * @param bufferSize Size of buffer; needs room for the element and its line ending
+     * @return Length of the element, 0 on failure or if it does not fit
+     * @throws None
+     * @details Same search as getLast() but never builds a String. In session mode
+     *          (config.keepOpen) the call does not touch the heap at all.
+     */
+    size_t getLast(char* buffer, const size_t bufferSize) const {
+        settleWriteBack();
+        const Guard guard = readGuard();
+        if (currentSize == 0) {DEBUG_PRINT("List is empty!"); return 0;}
+        File dataFile = openDataFile(FILE_READ);
+        if (!dataFile) {DEBUG_PRINT("Failed to open file for reading!"); return 0;}
 
+        size_t offset = 0;
+        const size_t length = locateLast(dataFile, offset) ? readLineInto(dataFile, offset, buffer, bufferSize) : 0;
+        closeDataFile(dataFile);
+        return length;
+    }
 
-            for(uint16_t i = bytesRead; i-- > 0;) {
-                if (buffer[i] == '\n') {
-                    if(i == bytesRead - 1) {
-                        const String val = readLineFromPos(pos+1+i, dataFile);
-                        if(val.length()>0 && val.charAt(0)!= TOMBSTONE) {dataFile.close(); return val;}
 
-                    }else if (buffer[i+1]!=TOMBSTONE){
-                        String val = readLineFromPos(pos+1+i, dataFile);
-                        if(val.length()>0) {dataFile.close(); return val;}
-                    }
-                }else if (i==0 && pos == 0){
-                    String val = readLineFromPos(0, dataFile);
-                    if(val.length()>0 && val.charAt(0)!= TOMBSTONE) {dataFile.close(); return val;}
-                }
-            }
-        }
-        DEBUG_PRINT("Failed to get last element!");
-        dataFile.close();
-        return "";
+    /**
+     * @brief Deserializes the last valid element straight from the file into a document
+     * @param doc Destination document
+     * @return true if successful, false on failure
+     * @throws None
+     * @details The record is parsed from the File stream; no intermediate String is built
+     */
+    bool getLast(JsonDocument& doc) const {
+        settleWriteBack();
+        const Guard guard = readGuard();
+        if (currentSize == 0) {DEBUG_PRINT("List is empty!"); return false;}
+        File dataFile = openDataFile(FILE_READ);
+        if (!dataFile) {DEBUG_PRINT("Failed to open file for reading!"); return false;}
+
+        size_t offset = 0;
+        const bool status = locateLast(dataFile, offset) && deserializeAt(dataFile, offset, doc);
+        closeDataFile(dataFile);
+        return status;
     }
 
 
@@ -249,11 +3061,60 @@ public:
      *          - Returns empty string on any error condition
      */
     [[nodiscard]] String get(const size_t index) const {
+        settleWriteBack(index);
+        const Guard guard = readGuard();
         if (index >= currentSize) {
             DEBUG_PRINT("Index out of bounds!");
             return ""; // Return an empty string to indicate failure
         }
-        return readLine(index);
+        return readLineAt(index);
+    }
+
+
+    /**
+     * @brief Copies the element at an index into a caller-provided buffer
+     * @param index Zero-based index of desired element
+     * @param buffer Destination, NUL-terminated on success
+     * @param bufferSize Size of buffer; needs room for the element and its line ending
+     * @return Length of the element, 0 on failure or if it does not fit
+     * @throws None
+     * @details The line is located through a stack buffer and copied straight from the
+     *          file, so no String is built. In session mode (config.keepOpen) the call
+     *          does not touch the heap at all.
+     */
+    size_t get(const size_t index, char* buffer, const size_t bufferSize) const {
+        settleWriteBack(index);
+        const Guard guard = readGuard();
+        if (index >= currentSize) {DEBUG_PRINT("Index out of bounds!"); return 0;}
+        File dataFile = openDataFile(FILE_READ);
+        if (!dataFile) {DEBUG_PRINT("Failed to open file for reading!"); return 0;}
+
+        size_t offset = 0;
+        const size_t length = locateLine(dataFile, index, offset) ? readLineInto(dataFile, offset, buffer, bufferSize) : 0;
+        closeDataFile(dataFile);
+        return length;
+    }
+
+
+    /**
+     * @brief Deserializes the element at an index straight from the file into a document
+     * @param index Zero-based index of desired element
+     * @param doc Destination document
+     * @return true if successful, false on failure
+     * @throws None
+     * @details The record is parsed from the File stream; no intermediate String is built
+     */
+    bool get(const size_t index, JsonDocument& doc) const {
+        settleWriteBack(index);
+        const Guard guard = readGuard();
+        if (index >= currentSize) {DEBUG_PRINT("Index out of bounds!"); return false;}
+        File dataFile = openDataFile(FILE_READ);
+        if (!dataFile) {DEBUG_PRINT("Failed to open file for reading!"); return false;}
+
+        size_t offset = 0;
+        const bool status = locateLine(dataFile, index, offset) && deserializeAt(dataFile, offset, doc);
+        closeDataFile(dataFile);
+        return status;
     }
 
 
@@ -261,10 +3122,12 @@ public:
      * @brief Returns current number of valid elements
      * @return Current size of list (excluding tombstone entries)
      * @throws None
-     * @details Constant time operation using cached size value
+     * @details Constant time operation using cached size value; counts records still in the
+     *          write-back buffer
      */
     [[nodiscard]] size_t size() const {
-        return currentSize;
+        const Guard guard = readGuard();
+        return currentSize + writeBack.records;
     }
 
 
@@ -278,36 +3141,69 @@ public:
      *          - Handles JSON parsing errors
      *          - Limits return size to min(count, currentSize)
      *          - Skips tombstone entries
-     *          - Validates JSON format of each element
+     *          - One forward pass over one file handle, like forEach()
      */
     [[nodiscard]] JsonDocument getFirst(const size_t count) const {
+        return getRange(0, count);
+    }
+
+
+    /**
+     * @brief Retrieves a page of consecutive elements as JSON array
+     * @param offset Index of the first element
+     * @param count Number of elements to retrieve
+     * @return JsonDocument containing array of retrieved elements, empty on failure
+     * @throws None
+     * @details
+     *          - Limits return size to min(count, size() - offset)
+     *          - Finds element `offset` like get() does: without the index, from the nearest
+     *            checkpoint at or before it (config.checkpointInterval) rather than the head
+     *          - One forward pass over one file handle; forEach() streams the same
+     *            range to a callback instead of collecting it
+     */
+    [[nodiscard]] JsonDocument getRange(const size_t offset, const size_t count) const {
+        if (count) settleWriteBack(count > SIZE_MAX - offset ? SIZE_MAX : offset + count - 1);
+        const Guard guard = readGuard();
         JsonDocument doc;
-        if (currentSize == 0) { DEBUG_PRINT("List is empty!"); return doc;}
-        const size_t numElements = min(count, currentSize);
-    
-        size_t validCount = 0;
-        for (size_t i = 0; validCount < numElements; i++) {
-            const String element = readLine(i);
-            if (element.isEmpty()) {
-                DEBUG_PRINT("Failed to get element!");
-                doc.clear();
-                return doc;
-            }
-            JsonDocument elementDoc;
-            DeserializationError error = deserializeJson(elementDoc, element);
-            if (error) {
-                DEBUG_PRINT(error.c_str(), "Json deserialization error");
-                doc.clear();
-                return doc;
-            }
-            doc.add(elementDoc);
-            validCount++;
+        if (currentSize == 0) {DEBUG_PRINT("List is empty!"); return doc;}
+        if (offset >= currentSize) {DEBUG_PRINT("Index out of bounds!"); return doc;}
+        const size_t numElements = min(count, currentSize - offset);
+
+        const size_t visited = visitRange(offset, numElements, [&](size_t, const JsonDocument& element) {
+            doc.add(element);
+            return true;
+        });
+        if (visited != numElements) {
+            DEBUG_PRINT("Failed to get element!");
+            doc.clear();
         }
-    
         return doc;
     }
 
 
+    /**
+     * @brief Streams consecutive elements to a callback in one pass
+     * @param from Index of the first element
+     * @param count Maximum number of elements to visit
+     * @param callback Called as callback(index, doc) with each element parsed into one reused
+     *        JsonDocument; returning false stops after that element
+     * @return Number of elements handed to callback
+     * @throws None
+     * @details Opens the data file once, finds element `from` like get() does, then walks the
+     *          records forward through a BUFFER_SIZE stack buffer. Records are parsed from
+     *          memory; only a record longer than the buffer is parsed from the file. The walk runs under the
+     *          list's lock, so callback must not call into the list. A record that does not
+     *          parse ends it.
+     */
+    template <typename Callback>
+    size_t forEach(const size_t from, const size_t count, Callback&& callback) const {
+        if (count == 0) return 0;
+        settleWriteBack(count > SIZE_MAX - from ? SIZE_MAX : from + count - 1);
+        const Guard guard = readGuard();
+        return visitRange(from, count, callback);
+    }
+
+
     /**
      * @brief Removes element at specified index
      * @param index Zero-based index of element to remove
@@ -322,29 +3218,113 @@ public:
      *          - Handles file positioning and cursor management
      */
     String remove(const size_t index) {
+        const Guard guard = writeGuard();
+        if (index >= currentSize) flushWriteBack();
         if (index >= currentSize) {DEBUG_PRINT("Index out of bounds!"); return "";}
     
         //gets the cursor position of the line to be removed
         size_t cursor_position =0;
-        String removedElement = readLine(index, &cursor_position);
+        size_t lineLength = 0;
+        String removedElement = readLineAt(index, &cursor_position, &lineLength);
         if (removedElement.isEmpty()) {DEBUG_PRINT("Failed to read line!"); return "";}
     
         // Remove the element from the file
-        File dataFile = SD.open(filePath, FILE_WRITE);
-        
-        dataFile.seek(dataFile.size(), SeekSet);
-        dataFile.seek(cursor_position, SeekSet);
-        dataFile.write(TOMBSTONE);
-    
-        dataFile.flush();
-        dataFile.close();
+        File dataFile = openDataFile(FILE_READ_WRITE);
+        if (!dataFile) {DEBUG_PRINT("Failed to open file for writing!"); return "";}
+
+        markDirty();
+        MEMORY_LIST_IO(seeks, 1);
+        MEMORY_LIST_IO(bytesWritten, 1);
+        if (!dataFile.seek(cursor_position, SeekSet) || dataFile.write(tombstoneByte()) != 1) {
+            closeDataFile(dataFile);
+            DEBUG_PRINT("Failed to remove element!");
+            return "";
+        }
+        closeDataFile(dataFile);
         currentSize--;
+        accountRemoved(lineLength);
+        if (index == currentSize) tailKnown = false;  // found again by the next getLast()
+        if (index == 0) headOffset = cursor_position + lineLength;
+        shiftCheckpoints(index, 1);
+        mirrorRemove(index);
+
+        if (config.useIndex && !eraseIndexEntry(index)) rebuildIndex();
 
-        if(shouldDefragment()) defragment();
+        defragmentIfDue();
         return removedElement;
     }
 
 
+    /**
+     * @brief Removes the elements at a set of indices in one pass
+     * @param indices Zero-based indices into the list as it is before the call, in any order;
+     *        duplicates and indices past the end are ignored
+     * @param count Number of indices
+     * @return Number of elements removed
+     * @throws None
+     * @details
+     *          - Sorts a heap copy of the indices
+     *          - Finds the records front to back in one forward pass over one read/write handle,
+     *            jumping to a checkpoint between two far apart indices, or through the index
+     *          - Tombstones each through that handle as it is found
+     *          - Updates the counters, the index and the checkpoints once
+     *          - Triggers defragmentation at most once, at the end
+     *          - Stops at a failed lookup or write; the elements before it stay removed
+     */
+    size_t removeMany(const size_t* indices, const size_t count) {
+        const Guard guard = writeGuard();
+        if (!indices || count == 0) return 0;
+        auto* targets = static_cast<size_t*>(malloc(count * sizeof(size_t)));
+        if (!targets) {DEBUG_PRINT("Failed to allocate the removal list!"); return 0;}
+        memcpy(targets, indices, count * sizeof(size_t));
+        std::sort(targets, targets + count);
+        size_t wanted = std::unique(targets, targets + count) - targets;
+        if (targets[wanted - 1] >= currentSize) flushWriteBack();
+        wanted = std::lower_bound(targets, targets + wanted, currentSize) - targets;
+
+        const size_t removed = wanted ? tombstoneMany(targets, wanted) : 0;
+        free(targets);
+        if (removed) defragmentIfDue();
+        return removed;
+    }
+
+
+    /**
+     * @brief Removes the elements at the indices of an array, see removeMany(const size_t*, size_t)
+     */
+    template <size_t N>
+    size_t removeMany(const size_t (&indices)[N]) {
+        return removeMany(indices, N);
+    }
+
+
+    /**
+     * @brief Removes every element a predicate matches, in one pass
+     * @param predicate Called once per element, in list order, as predicate(doc) with the element
+     *        parsed into one reused JsonDocument, or as predicate(payload, length) with the
+     *        record's raw payload when it takes `(const char*, size_t)`: the JSON text without
+     *        its line ending, or the MessagePack bytes of a packed record. Returns true to remove.
+     * @return Number of elements removed
+     * @throws None
+     * @details
+     *          - Streams the records front to back through one read/write handle, like forEach()
+     *          - Tombstones each match through that handle before reading on
+     *          - Updates the counters, the index and the checkpoints once
+     *          - Triggers defragmentation at most once, at the end
+     *          - Runs under the list's lock, so predicate must not call into the list
+     *          - Stops at a record that does not parse or a failed write; the matches before it
+     *            stay removed
+     */
+    template <typename Predicate>
+    size_t removeIf(Predicate&& predicate) {
+        const Guard guard = writeGuard();
+        flushWriteBack();
+        const size_t removed = tombstoneWhere(predicate);
+        if (removed) defragmentIfDue();
+        return removed;
+    }
+
+
     /**
      * @brief Clears all elements from the list
      * @throws None
@@ -356,63 +3336,73 @@ public:
      *          - Ensures atomic operation
      */
     void clear() {
-        if (SD.remove(filePath)) {
+        const Guard guard = writeGuard();
+        abortCompaction();
+        writeBack.used = 0;
+        writeBack.records = 0;
+        markDirty();
+        endSession();
+        const bool removed = SD.remove(filePath);
+        if (removed) {
             Serial.println("cleared successfully!");
             SD.open(filePath, FILE_WRITE).close();
             currentSize = 0;
+            liveBytes = 0;
+            deadBytes = 0;
+            maxRecordLength = 0;
+            tailKnown = false;
+            checkpointCount = 0;
+            checkpointStride = initialStride();
+            binaryRecords = binaryByDefault();
         } else {
             DEBUG_PRINT("Failed to clear file!");
         }
+        if (config.keepOpen) beginSession();
+        if (removed && config.useIndex) rebuildIndex();
+        if (removed) {
+            headOffset = 0;
+            saveState(true);
+        }
     }
 
 
     /**
      * @brief Removes first n elements from the list
-     * @param count Number of elements to remove
+     * @param count Number of elements to remove, at most UINT16_MAX per call
      * @return Number of elements actually removed
      * @throws None
      * @details 
-     *          - Optimized batch removal operation
-     *          - Uses buffered reading for efficiency
-     *          - Tracks file positions for deletion
+     *          - Starts at the head offset, never rescans the tombstoned prefix
+     *          - Tombstones lines in a single pass, O(count) with no per-call arrays
+     *          - Advances the head offset past the removed lines
      *          - Updates currentSize for each removal
      *          - Triggers defragmentation if needed
      *          - Handles partial success cases
      */
     uint16_t removeFirst(const size_t count) {
+        const Guard guard = writeGuard();
+        if (count > currentSize) flushWriteBack();
         if (currentSize == 0) {DEBUG_PRINT("List is empty!");return 0;}
-        File dataFile = SD.open(filePath, FILE_READ);
-        if (!dataFile) {DEBUG_PRINT("Failed to open file for reading!");return 0;}
-
-        const size_t count_ = min(count, currentSize);
-        size_t positions[count_];
-        uint16_t readLines = 0;
-        size_t currentPos = 0;
-        ReadBufferingStream reader(dataFile, 64);
-
-        while (reader.available() && readLines < count_) {
-            String line = reader.readStringUntil('\n');
-            line.trim();
-            if (line.length() > 0 && line[0] != TOMBSTONE) {
-                positions[readLines++] = currentPos;
-            }
-            currentPos += line.length() + 1;
-        }
-        dataFile.close();
-        
-        dataFile = SD.open(filePath, FILE_WRITE);
-        if (!dataFile) {DEBUG_PRINT("Failed to open file for writing!");return 0;}
-        dataFile.seek(dataFile.size(), SeekSet);
-        
-        for (uint16_t i = 0; i < readLines && dataFile.seek(positions[i], SeekSet); i++){
-             dataFile.write(TOMBSTONE);
-             currentSize--;
-        }
 
-        dataFile.flush();
-        dataFile.close();
-        if(shouldDefragment()) defragment();
-        return readLines;
+        const size_t count_ = min(min(count, currentSize), static_cast<size_t>(UINT16_MAX));  // fits the return type
+        File dataFile = openDataFile(FILE_READ_WRITE);
+        if (!dataFile) {DEBUG_PRINT("Failed to open file for writing!");return 0;}
+        markDirty();
+
+        size_t cursorPosition = headOffset;
+        size_t removedBytes = 0;
+        const size_t removed = tombstoneFrom(dataFile, cursorPosition, count_, removedBytes);
+        closeDataFile(dataFile);
+        currentSize -= removed;
+        accountRemoved(removedBytes);
+
+        headOffset = cursorPosition;
+        if (currentSize == 0) tailKnown = false;
+        shiftCheckpoints(0, removed);
+        mirrorRemoveFirst(removed);
+        if (config.useIndex && !dropIndexEntries(removed)) rebuildIndex();
+        defragmentIfDue();
+        return removed;
     }
 
 
@@ -422,7 +3412,7 @@ public:
      * @throws None
      * @details 
      *          - Creates temporary file
-     *          - Copies valid entries sequentially
+     *          - Copies valid entries sequentially, starting at the head offset
      *          - Handles file operation errors
      *          - Manages atomic file replacement
      *          - Updates currentSize
@@ -430,51 +3420,30 @@ public:
      *          - Uses buffered operations for efficiency
      */
     bool defragment() {
-        const String tempPath = filePath + ".tmp";
-
-        File sourceFile = SD.open(filePath, FILE_READ);
-        if (sourceFile.size() == 0) {DEBUG_PRINT("File is empty, no need to defragment");return true;}
-        File tempFile = SD.open(tempPath, FILE_WRITE);
-        if (!sourceFile || !tempFile) {
-            DEBUG_PRINT("Failed to open files!");
-            if (sourceFile) sourceFile.close();
-            if (tempFile) tempFile.close();
-            return false;
-        }
-
-        size_t validCount = 0;
-        ReadBufferingStream reader(sourceFile, 64);
-        while(reader.available()) {
-            String line = reader.readStringUntil('\n');
-            line.trim();
-            if (line.length() > 0 && line[0] != TOMBSTONE) {
-                if(!tempFile.println(line)){
-                    DEBUG_PRINT("Write to temp file failed!");
-                    sourceFile.close();
-                    tempFile.close();
-                    SD.remove(tempPath);
-                    return false;
-                }
-                validCount++;
-            }
-        }
-        sourceFile.close();
-        tempFile.flush();
-        tempFile.close();
-
+        const Guard guard = writeGuard();
+        return compactAll();
+    }
 
-        if (!SD.remove(filePath)) {DEBUG_PRINT("Failed to remove original file!");
-            SD.remove(tempPath);
-            return false;
-        }
-        if (!SD.rename(tempPath, filePath)) { DEBUG_PRINT("Failed to rename temp file!");
-            SD.remove(tempPath);
-            return false;
-        }
 
-        currentSize = validCount;
-        DEBUG_PRINT("Defragmentation complete. Valid entries: " + String(validCount));
-        return true;
+    /**
+     * @brief Runs a bounded slice of an incremental defragmentation
+     * @param byteBudget Data file bytes to process in this call, at least one record is processed
+     * @param microsBudget Optional time limit for this call, 0 for none
+     * @return true while more steps are needed, false once the compaction is done or on failure
+     * @throws None
+     * @details
+     *          - Starts a compaction on the first call if there are dead bytes
+     *          - Appends live records from the data file to the temp file, stopping only at
+     *            record boundaries once the budget is spent
+     *          - The list stays fully usable between steps: pushes are picked up by later
+     *            steps and removals of already copied records are repeated on the temp file
+     *          - The last step swaps the files like defragment(); with the index enabled
+     *            it is rebuilt there
+     *          - defragment() and clear() abandon a compaction in progress
+     */
+    bool defragmentStep(const size_t byteBudget, const unsigned long microsBudget = 0) {
+        const Guard guard = writeGuard();
+        return compactStep(byteBudget, microsBudget);
     }
 
 
@@ -482,38 +3451,21 @@ public:
      * @brief Reads specific line from file
      * @param line_no Line number to read
      * @param cursorPosition Optional pointer to store cursor position
+     * @param lineLength Optional pointer to store the raw line length, newline included
      * @return String containing the line read, empty string on failure
      * @throws None
      * @details 
      *          - Skips tombstone entries
-     *          - Uses buffered reading
-     *          - Tracks valid line count
-     *          - Manages file positioning
+     *          - One index lookup when the index is enabled
+     *          - Otherwise scans through a stack buffer from the nearest checkpoint before
+     *            the line (config.checkpointInterval, config.checkpointBudget) or the head offset
+     *          - Only the requested line is turned into a String
      *          - Optional cursor position tracking
      */
-    [[nodiscard]] String readLine(const size_t line_no, size_t* cursorPosition = nullptr) const {
-        File dataFile = SD.open(filePath, FILE_READ);
-        if (!dataFile) { DEBUG_PRINT("Failed to open file for reading!"); return "";}
-        if(!dataFile.seek(0)) {DEBUG_PRINT(0,"Failed to seek to position!"); return "";}
-
-        size_t validLineCount = 0;
-        size_t cursorPosition_ = 0;
-        ReadBufferingStream reader(dataFile, 64); 
-        while (reader.available()) {
-            String line = reader.readStringUntil('\n');
-            if (line[0] != TOMBSTONE) {
-                if (validLineCount == line_no) {
-                    if(cursorPosition!=nullptr) *cursorPosition = cursorPosition_;
-                    line.trim();
-                    return line;
-                }
-                validLineCount++;
-            }
-            cursorPosition_ += line.length() + 1;
-        }
-        if(cursorPosition) *cursorPosition = cursorPosition_;
-        dataFile.close();
-        return "";
+    [[nodiscard]] String readLine(const size_t line_no, size_t* cursorPosition = nullptr, size_t* lineLength = nullptr) const {
+        settleWriteBack(line_no);
+        const Guard guard = readGuard();
+        return readLineAt(line_no, cursorPosition, lineLength);
     }
 
 
@@ -524,18 +3476,20 @@ public:
      *          - Prints all entries including tombstones
      *          - Uses buffered reading
      *          - Handles file operation errors
-     *          - Formats output with markers
+     *          - Formats output with markers; removed binary records are shown with a leading '$'
      */
     void print_all() const {
-        File dataFile = SD.open(filePath, "r");
+        settleWriteBack();
+        const Guard guard = readGuard();
+        File dataFile = openDataFile(FILE_READ);
         DEBUG_PRINT("--printBgn--");
-        ReadBufferingStream reader(dataFile, 64); 
-        while (reader.available()) {
-            String line = reader.readStringUntil('\n');
-            line.trim();
-            Serial.println(line);
-        }
-        dataFile.close();
+        uint8_t buffer[BUFFER_SIZE];
+        walkRecords(dataFile, 0, buffer, sizeof(buffer), [&](const size_t offset, size_t, const bool live) {
+            const String line = readLineFromPos(offset, dataFile);
+            Serial.println(binaryRecords && !live ? String(TOMBSTONE) + line : line);
+            return true;
+        });
+        closeDataFile(dataFile);
         DEBUG_PRINT("--printEnd--");
     }
 
@@ -547,32 +3501,12 @@ public:
      * @details 
      *          - Calculates ratio of invalid to total space
      *          - Handles empty file case
-     *          - Uses buffered reading
+     *          - Constant time, uses the live/dead byte counters
      *          - Accounts for newlines in calculations
-     *          - Precise floating-point calculations
      */
     [[nodiscard]] float getFragmentationRatio() const {
-        File dataFile = SD.open(filePath, FILE_READ);
-        if (!dataFile) {
-            DEBUG_PRINT("Failed to open file for reading!");
-            return 0.0f;
-        }
-
-        const float rawFileSize = static_cast<float>(dataFile.size());
-        if (rawFileSize == 0) {dataFile.close();return 0.0f;}
-
-        float validDataSize = 0.0f;
-        ReadBufferingStream reader(dataFile, 64); // 64 is the buffer size
-
-        while (reader.available()) {
-            String line = reader.readStringUntil('\n');
-            if (line.length() > 0 && line[0] != TOMBSTONE) {
-                validDataSize += line.length() + 1; // +1 for newline
-            }
-        }
-
-        dataFile.close();
-        return (rawFileSize - validDataSize) / rawFileSize;
+        const Guard guard = readGuard();
+        return fragmentationRatio();
     }
 
 
@@ -585,18 +3519,18 @@ public:
      *          - Compares current fragmentation to threshold
      *          - Configurable threshold value
      *          - Logs debug information
-     *          - Uses cached fragmentation data when available
+     *          - Constant time, no file access
      */
     bool shouldDefragment(const float threshold = 0.7f) const {
-        const float fragRatio = getFragmentationRatio();
-        if (fragRatio >= threshold) {
-            DEBUG_PRINT("Fragmentation ratio " + String(fragRatio * 100) + "% exceeds threshold " + String(threshold * 100) + "%");
-            return true;
-        }
-        return false;
+        const Guard guard = readGuard();
+        return defragmentDue(threshold);
     }
 
 };
 
 
+/** @brief The list without locking, for use from a single task */
+using MemoryList = BasicMemoryList<>;
+
+
 #endif
\ No newline at end of file
@@ -0,0 +1,403 @@
+#include <unity.h>
+#include <Arduino.h>
+#include "MemoryList.h"
+#include <ArduinoJson.h>
+
+/*
+ * MemoryList benchmarks. Results are printed, not asserted, so they can be
+ * compared between cards, boards and commits.
+ */
+
+constexpr size_t BENCH_RECORDS = 200;
+constexpr size_t BOOT_RECORDS = 1000000;
+const char* BENCH_FILE = "/bench.txt";
+
+// Largest list the scale suite fills; lower it with -DBENCH_MAX_RECORDS for slow cards
+#ifndef BENCH_MAX_RECORDS
+#define BENCH_MAX_RECORDS 1000000
+#endif
+constexpr size_t SCALE_SIZES[] = {1000, 10000, 100000, 1000000};
+constexpr size_t SCALE_OPS = 20;       // repetitions of operations independent of list size
+constexpr size_t SCALE_SLOW_OPS = 3;   // repetitions of operations that walk the file
+
+struct BenchResult {
+    float push;
+    float get;
+    float getLast;
+    float remove;
+};
+
+void setUp(void) {
+    SD.begin();
+}
+
+void tearDown(void) {
+    SD.remove(BENCH_FILE);
+    SD.remove(String(BENCH_FILE) + ".idx");
+    SD.remove(String(BENCH_FILE) + ".meta");
+}
+
+float opsPerSecond(const size_t ops, const unsigned long elapsedMicros) {
+    return elapsedMicros ? ops * 1000000.0f / elapsedMicros : 0.0f;
+}
+
+void printResult(const char* label, const BenchResult& result) {
+    char line[160];
+    snprintf(line, sizeof(line), "%-14s push %9.1f  get %9.1f  getLast %9.1f  remove %9.1f  ops/s",
+             label, result.push, result.get, result.getLast, result.remove);
+    TEST_MESSAGE(line);
+}
+
+BenchResult runOperations(const MemoryListConfig& config) {
+    MemoryList list(BENCH_FILE, config);
+    list.clear();
+    BenchResult result{};
+
+    JsonDocument doc;
+    doc["temp"] = 21.5;
+    doc["hum"] = 48.25;
+
+    unsigned long start = micros();
+    for (size_t i = 0; i < BENCH_RECORDS; i++) {
+        doc["time"] = i;
+        list.push(doc.as<JsonObjectConst>());
+    }
+    result.push = opsPerSecond(BENCH_RECORDS, micros() - start);
+
+    start = micros();
+    for (size_t i = 0; i < BENCH_RECORDS; i++) {
+        TEST_ASSERT_FALSE(list.get(i).isEmpty());
+    }
+    result.get = opsPerSecond(BENCH_RECORDS, micros() - start);
+
+    start = micros();
+    for (size_t i = 0; i < BENCH_RECORDS; i++) {
+        TEST_ASSERT_FALSE(list.getLast().isEmpty());
+    }
+    result.getLast = opsPerSecond(BENCH_RECORDS, micros() - start);
+
+    start = micros();
+    for (size_t i = 0; i < BENCH_RECORDS; i++) {
+        TEST_ASSERT_FALSE(list.remove(0).isEmpty());
+    }
+    result.remove = opsPerSecond(BENCH_RECORDS, micros() - start);
+
+    list.sync();
+    TEST_ASSERT_EQUAL(0, list.size());
+    return result;
+}
+
+void test_session_vs_open_per_call(void) {
+    MemoryListConfig openPerCall;
+    MemoryListConfig session;
+    session.keepOpen = true;
+
+    printResult("open-per-call", runOperations(openPerCall));
+    printResult("session", runOperations(session));
+}
+
+void test_push_vs_pushBatch(void) {
+    MemoryList list(BENCH_FILE);
+    list.clear();
+
+    JsonDocument batch;
+    for (size_t i = 0; i < BENCH_RECORDS; i++) {
+        JsonObject record = batch.add<JsonObject>();
+        record["time"] = i;
+        record["temp"] = 21.5;
+        record["hum"] = 48.25;
+    }
+
+    unsigned long start = micros();
+    for (const JsonVariantConst record : batch.as<JsonArrayConst>()) {
+        list.push(record.as<JsonObjectConst>());
+    }
+    const float single = opsPerSecond(BENCH_RECORDS, micros() - start);
+
+    start = micros();
+    TEST_ASSERT_EQUAL(BENCH_RECORDS, list.pushBatch(batch.as<JsonArrayConst>()));
+    const float batched = opsPerSecond(BENCH_RECORDS, micros() - start);
+    TEST_ASSERT_EQUAL(2 * BENCH_RECORDS, list.size());
+
+    char line[96];
+    snprintf(line, sizeof(line), "push %9.1f  pushBatch %9.1f  records/s", single, batched);
+    TEST_MESSAGE(line);
+}
+
+float pushRate(const MemoryListConfig& config) {
+    MemoryList list(BENCH_FILE, config);
+    list.clear();
+    JsonDocument doc;
+    doc["temp"] = 21.5;
+    doc["hum"] = 48.25;
+
+    const unsigned long start = micros();
+    for (size_t i = 0; i < BENCH_RECORDS; i++) {
+        doc["time"] = i;
+        TEST_ASSERT_TRUE(list.push(doc.as<JsonObjectConst>()));
+    }
+    list.flush();
+    const float rate = opsPerSecond(BENCH_RECORDS, micros() - start);
+    TEST_ASSERT_EQUAL(BENCH_RECORDS, list.calcSize());
+    return rate;
+}
+
+void test_push_write_back(void) {
+    MemoryListConfig writeBack;
+    writeBack.writeBackSize = 4096;
+    writeBack.writeBackTimeout = 0;
+
+    const float direct = pushRate(MemoryListConfig());
+    const float buffered = pushRate(writeBack);
+
+    char line[96];
+    snprintf(line, sizeof(line), "push %9.1f  write-back push %9.1f  records/s", direct, buffered);
+    TEST_MESSAGE(line);
+}
+
+/**
+ * Fills a list with logger records and times reading them back, parsed and as text.
+ * Bytes per record include the line ending or binary header.
+ */
+void runEncoding(const char* label, const MemoryListConfig& config) {
+    MemoryList list(BENCH_FILE, config);
+    list.clear();
+
+    JsonDocument batch;
+    for (size_t i = 0; i < BENCH_RECORDS; i++) {
+        JsonObject record = batch.add<JsonObject>();
+        record["time"] = 1700000000 + i * 60;
+        record["temp"] = 21.5 + i % 7;
+        record["hum"] = 48.25;
+        record["device"] = "logger-01";
+        record["ok"] = true;
+    }
+    TEST_ASSERT_EQUAL(BENCH_RECORDS, list.pushBatch(batch.as<JsonArrayConst>()));
+
+    JsonDocument doc;
+    unsigned long start = micros();
+    for (size_t i = 0; i < BENCH_RECORDS; i++) {
+        TEST_ASSERT_TRUE(list.get(i, doc));
+    }
+    const float parsed = opsPerSecond(BENCH_RECORDS, micros() - start);
+
+    start = micros();
+    for (size_t i = 0; i < BENCH_RECORDS; i++) {
+        TEST_ASSERT_FALSE(list.get(i).isEmpty());
+    }
+    const float text = opsPerSecond(BENCH_RECORDS, micros() - start);
+
+    const float bytesPerRecord = list.getStats()["fileSize"].as<float>() / BENCH_RECORDS;
+    char line[160];
+    snprintf(line, sizeof(line), "%-12s %6.1f bytes/record  get(doc) %9.1f  get() %9.1f  records/s",
+             label, bytesPerRecord, parsed, text);
+    TEST_MESSAGE(line);
+}
+
+void test_json_vs_msgpack(void) {
+    MemoryListConfig text;
+    text.keepOpen = true;
+    text.useIndex = true;
+    MemoryListConfig binary = text;
+    binary.format = RecordFormat::Binary;
+    MemoryListConfig packed = text;
+    packed.encoding = RecordEncoding::MessagePack;
+
+    runEncoding("text json", text);
+    runEncoding("binary json", binary);
+    runEncoding("msgpack", packed);
+}
+
+/**
+ * Writes records lines straight to the card, far faster than pushing them.
+ * Lines vary between roughly 40 and 100 bytes, and every tenth one is tombstoned
+ * so scans also have dead bytes to account for.
+ */
+void writeFixture(const size_t records) {
+    File file = SD.open(BENCH_FILE, FILE_WRITE);
+    TEST_ASSERT_TRUE(static_cast<bool>(file));
+    char chunk[4096];
+    char pad[64];
+    memset(pad, 'x', sizeof(pad));
+    size_t used = 0;
+    for (size_t i = 0; i < records; i++) {
+        if (sizeof(chunk) - used < 128) {
+            TEST_ASSERT_EQUAL(used, file.write(reinterpret_cast<const uint8_t*>(chunk), used));
+            used = 0;
+        }
+        used += snprintf(chunk + used, sizeof(chunk) - used, "%s{\"time\":%u,\"temp\":21.5,\"hum\":48.25,\"pad\":\"%.*s\"}\r\n",
+                         i % 10 == 0 ? "$" : "", static_cast<unsigned>(i), static_cast<int>(i * 37 % sizeof(pad)), pad);
+    }
+    TEST_ASSERT_EQUAL(used, file.write(reinterpret_cast<const uint8_t*>(chunk), used));
+    file.close();
+}
+
+/**
+ * Card traffic so far. The native SD stand-in counts every file; on a board the
+ * figures come from the list's own MEMORY_LIST_IO_STATS counters, and are left
+ * out of the results when there is no list to ask.
+ */
+struct IoSnapshot {
+    bool valid = false;
+    uint32_t opens = 0;
+    uint64_t bytesRead = 0;
+    uint64_t bytesWritten = 0;
+};
+
+IoSnapshot ioSnapshot([[maybe_unused]] const MemoryList* list) {
+    IoSnapshot snapshot;
+#ifdef MEMORY_LIST_NATIVE
+    const fs::IoCounters& counters = fs::IoCounters::active();
+    snapshot.valid = true;
+    snapshot.opens = counters.opens;
+    snapshot.bytesRead = counters.bytesRead;
+    snapshot.bytesWritten = counters.bytesWritten;
+#elif defined(MEMORY_LIST_IO_STATS)
+    if (list) {
+        const JsonDocument stats = list->getStats();
+        snapshot.valid = true;
+        snapshot.opens = stats["opens"];
+        snapshot.bytesRead = stats["bytesRead"];
+        snapshot.bytesWritten = stats["bytesWritten"];
+    }
+#endif
+    return snapshot;
+}
+
+/**
+ * Runs operation ops times and prints one JSON line, e.g.
+ * {"bench":"scale","records":1000,"op":"get_head","ops":20,"opsPerSec":812.3,"bytesRead":512,...}
+ * I/O figures are per operation, counted on list when the card itself is not.
+ */
+template <typename Operation>
+void measure(const size_t records, const char* op, const size_t ops, Operation operation, const MemoryList* list = nullptr) {
+    const IoSnapshot before = ioSnapshot(list);
+    const unsigned long start = micros();
+    for (size_t i = 0; i < ops; i++) operation();
+    const unsigned long elapsed = micros() - start;
+    const IoSnapshot after = ioSnapshot(list);
+
+    JsonDocument result;
+    result["bench"] = "scale";
+    result["records"] = records;
+    result["op"] = op;
+    result["ops"] = ops;
+    result["opsPerSec"] = opsPerSecond(ops, elapsed);
+    if (before.valid && after.valid) {
+        result["bytesRead"] = (after.bytesRead - before.bytesRead) / ops;
+        result["bytesWritten"] = (after.bytesWritten - before.bytesWritten) / ops;
+        result["opens"] = static_cast<float>(after.opens - before.opens) / ops;
+    }
+    serializeJson(result, Serial);
+    Serial.println();
+}
+
+void runScale(const size_t records) {
+    writeFixture(records);
+    measure(records, "construct", 1, [] {MemoryList list(BENCH_FILE);});
+
+    MemoryList list(BENCH_FILE);
+    TEST_ASSERT_EQUAL(records - (records + 9) / 10, list.size());
+    JsonDocument doc;
+    doc["time"] = records;
+    doc["temp"] = 21.5;
+    doc["hum"] = 48.25;
+
+    measure(records, "getStats", SCALE_OPS, [&] {TEST_ASSERT_EQUAL(list.size(), list.getStats()["size"].as<size_t>());}, &list);
+    measure(records, "push", SCALE_OPS, [&] {TEST_ASSERT_TRUE(list.push(doc.as<JsonObjectConst>()));}, &list);
+    measure(records, "get_head", SCALE_OPS, [&] {TEST_ASSERT_FALSE(list.get(0).isEmpty());}, &list);
+    measure(records, "get_middle", SCALE_SLOW_OPS, [&] {TEST_ASSERT_FALSE(list.get(list.size() / 2).isEmpty());}, &list);
+    measure(records, "get_tail", SCALE_SLOW_OPS, [&] {TEST_ASSERT_FALSE(list.get(list.size() - 1).isEmpty());}, &list);
+    measure(records, "getLast", SCALE_OPS, [&] {TEST_ASSERT_FALSE(list.getLast().isEmpty());}, &list);
+    measure(records, "getFirst", SCALE_OPS, [&] {TEST_ASSERT_EQUAL(10, list.getFirst(10).size());}, &list);
+    measure(records, "forEach_500", SCALE_SLOW_OPS, [&] {
+        TEST_ASSERT_EQUAL(500, list.forEach(list.size() / 4, 500, [](size_t, const JsonDocument&) {return true;}));
+    }, &list);
+    measure(records, "getRange_50", SCALE_SLOW_OPS, [&] {TEST_ASSERT_EQUAL(50, list.getRange(list.size() * 3 / 4, 50).size());}, &list);
+    {
+        MemoryListConfig config;
+        config.checkpointInterval = 256;
+        const MemoryList paged(BENCH_FILE, config);
+        measure(records, "getRange_50_checkpoints", SCALE_SLOW_OPS, [&] {TEST_ASSERT_EQUAL(50, paged.getRange(paged.size() * 3 / 4, 50).size());}, &paged);
+    }
+    {
+        MemoryListConfig config;
+        config.checkpointBudget = 4096;
+        const MemoryList sparse(BENCH_FILE, config);
+        measure(records, "get_middle_checkpoints", SCALE_SLOW_OPS, [&] {TEST_ASSERT_FALSE(sparse.get(sparse.size() / 2).isEmpty());}, &sparse);
+    }
+    measure(records, "remove", SCALE_SLOW_OPS, [&] {TEST_ASSERT_FALSE(list.remove(list.size() / 2).isEmpty());}, &list);
+    measure(records, "removeMany_10", SCALE_SLOW_OPS, [&] {
+        size_t indices[10];
+        for (size_t k = 0; k < 10; k++) indices[k] = list.size() * k / 10 + 1;
+        TEST_ASSERT_EQUAL(10, list.removeMany(indices));
+    }, &list);
+    measure(records, "removeIf_1000th", SCALE_SLOW_OPS, [&] {
+        const size_t total = list.size();
+        size_t seen = 0;
+        TEST_ASSERT_EQUAL(total / 1000, list.removeIf([&](const JsonDocument&) {return ++seen % 1000 == 0;}));
+        TEST_ASSERT_EQUAL(total, seen);
+    }, &list);
+    measure(records, "removeFirst", SCALE_OPS, [&] {TEST_ASSERT_EQUAL(10, list.removeFirst(10));}, &list);
+    measure(records, "defragment", 1, [&] {TEST_ASSERT_TRUE(list.defragment());}, &list);
+}
+
+void test_scale_suite(void) {
+    for (const size_t records : SCALE_SIZES) {
+        if (records <= BENCH_MAX_RECORDS) runScale(records);
+    }
+}
+
+void test_boot_time_million_records(void) {
+    writeFixture(BOOT_RECORDS);
+
+    unsigned long start = micros();
+    MemoryList list(BENCH_FILE);
+    const unsigned long bootMicros = micros() - start;
+    TEST_ASSERT_EQUAL(BOOT_RECORDS - BOOT_RECORDS / 10, list.size());
+
+    // The String-per-line pass the constructor used to run
+    start = micros();
+    TEST_ASSERT_EQUAL(list.size(), list.calcSize());
+    const unsigned long legacyMicros = micros() - start;
+
+    // A clean reopen with persisted state; the first instance scans once and saves it
+    MemoryListConfig config;
+    config.persistState = true;
+    { MemoryList saving(BENCH_FILE, config); }
+    start = micros();
+    MemoryList fastStart(BENCH_FILE, config);
+    const unsigned long fastMicros = micros() - start;
+    TEST_ASSERT_EQUAL(list.size(), fastStart.size());
+
+    char line[160];
+    snprintf(line, sizeof(line), "%u records  boot %lu ms  fast start %lu ms  calcSize() pass %lu ms",
+             static_cast<unsigned>(BOOT_RECORDS), bootMicros / 1000, fastMicros / 1000, legacyMicros / 1000);
+    TEST_MESSAGE(line);
+}
+
+int RUN_UNITY_TESTS() {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_session_vs_open_per_call);
+    RUN_TEST(test_push_vs_pushBatch);
+    RUN_TEST(test_push_write_back);
+    RUN_TEST(test_json_vs_msgpack);
+    RUN_TEST(test_boot_time_million_records);
+    RUN_TEST(test_scale_suite);
+
+    return UNITY_END();
+}
+
+void setup() {
+    delay(2000);
+    RUN_UNITY_TESTS();
+}
+
+void loop() {}
+
+#ifdef MEMORY_LIST_NATIVE
+int main() {
+    return RUN_UNITY_TESTS();
+}
+#endif
@@ -0,0 +1,285 @@
+/**
+ * @file Arduino.h
+ * @brief Minimal host-side stand-in for the Arduino core
+ * @details Provides just enough of the Arduino API (String, Print, Stream, Serial,
+ *          timing helpers) to compile MemoryList.h and its tests on a workstation.
+ *          Time is a virtual clock: real elapsed time plus whatever latency the
+ *          SD stand-in charges, so benchmarks see modeled card cost through micros().
+ */
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+using std::min;
+using std::max;
+
+#define IRAM_ATTR
+#define F(str) (str)
+
+namespace native {
+    /** @brief Microseconds of simulated latency accumulated by the SD stand-in */
+    inline std::atomic<uint64_t>& simulatedMicros() {
+        static std::atomic<uint64_t> value{0};
+        return value;
+    }
+
+    inline uint64_t realMicros() {
+        static const auto start = std::chrono::steady_clock::now();
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+inline unsigned long micros() {return static_cast<unsigned long>(native::realMicros() + native::simulatedMicros());}
+inline unsigned long millis() {return micros() / 1000;}
+inline void delay(const unsigned long ms) {std::this_thread::sleep_for(std::chrono::milliseconds(ms));}
+inline void delayMicroseconds(const unsigned int us) {std::this_thread::sleep_for(std::chrono::microseconds(us));}
+inline void yield() {std::this_thread::yield();}
+inline void randomSeed(const unsigned long seed) {srand(static_cast<unsigned>(seed));}
+inline long random(const long howBig) {return howBig ? rand() % howBig : 0;}
+inline long random(const long howSmall, const long howBig) {return howSmall >= howBig ? howSmall : howSmall + random(howBig - howSmall);}
+
+
+class String {
+private:
+    std::string buffer;
+
+public:
+    String() = default;
+    String(const char* str) : buffer(str ? str : "") {}
+    String(const char* str, const size_t length) : buffer(str, length) {}
+    String(const std::string& str) : buffer(str) {}
+    explicit String(const char c) : buffer(1, c) {}
+    explicit String(const unsigned char value, const unsigned char base = 10) : String(static_cast<unsigned long>(value), base) {}
+    explicit String(const int value, const unsigned char base = 10) : String(static_cast<long>(value), base) {}
+    explicit String(const unsigned int value, const unsigned char base = 10) : String(static_cast<unsigned long>(value), base) {}
+    explicit String(const long value, const unsigned char base = 10) {
+        if (value < 0) {buffer = "-" + toBase(static_cast<unsigned long long>(-value), base);}
+        else buffer = toBase(static_cast<unsigned long long>(value), base);
+    }
+    explicit String(const unsigned long value, const unsigned char base = 10) : buffer(toBase(value, base)) {}
+    explicit String(const long long value, const unsigned char base = 10) : String(static_cast<long>(value), base) {}
+    explicit String(const unsigned long long value, const unsigned char base = 10) : buffer(toBase(value, base)) {}
+    explicit String(const float value, const unsigned char decimalPlaces = 2) : String(static_cast<double>(value), decimalPlaces) {}
+    explicit String(const double value, const unsigned char decimalPlaces = 2) {
+        char tmp[64];
+        snprintf(tmp, sizeof(tmp), "%.*f", decimalPlaces, value);
+        buffer = tmp;
+    }
+
+    /** @brief Mirrors Arduino's safe-bool idiom: a constructed String is always valid */
+    explicit operator bool() const {return true;}
+
+    [[nodiscard]] const char* c_str() const {return buffer.c_str();}
+    [[nodiscard]] unsigned int length() const {return static_cast<unsigned int>(buffer.size());}
+    [[nodiscard]] bool isEmpty() const {return buffer.empty();}
+    bool reserve(const unsigned int size) {buffer.reserve(size); return true;}
+
+    bool concat(const String& str) {buffer += str.buffer; return true;}
+    bool concat(const char* str) {if (!str) return false; buffer += str; return true;}
+    bool concat(const char* str, const unsigned int length) {if (!str) return false; buffer.append(str, length); return true;}
+    bool concat(const char c) {buffer += c; return true;}
+    template <typename T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
+    bool concat(const T value) {return concat(String(value));}
+
+    String& operator+=(const String& rhs) {concat(rhs); return *this;}
+    String& operator+=(const char* rhs) {concat(rhs); return *this;}
+    String& operator+=(const char rhs) {concat(rhs); return *this;}
+    template <typename T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
+    String& operator+=(const T rhs) {concat(rhs); return *this;}
+
+    friend String operator+(const String& lhs, const String& rhs) {String r(lhs); r += rhs; return r;}
+    friend String operator+(const String& lhs, const char* rhs) {String r(lhs); r += rhs; return r;}
+    friend String operator+(const char* lhs, const String& rhs) {String r(lhs); r += rhs; return r;}
+    friend String operator+(const String& lhs, const char rhs) {String r(lhs); r += rhs; return r;}
+
+    bool operator==(const String& rhs) const {return buffer == rhs.buffer;}
+    bool operator==(const char* rhs) const {return buffer == (rhs ? rhs : "");}
+    bool operator!=(const String& rhs) const {return !(*this == rhs);}
+    bool operator!=(const char* rhs) const {return !(*this == rhs);}
+    bool operator<(const String& rhs) const {return buffer < rhs.buffer;}
+    [[nodiscard]] bool equals(const String& rhs) const {return *this == rhs;}
+
+    char operator[](const unsigned int index) const {return index < buffer.size() ? buffer[index] : '\0';}
+    char& operator[](const unsigned int index) {return buffer[index];}
+    [[nodiscard]] char charAt(const unsigned int index) const {return (*this)[index];}
+
+    [[nodiscard]] bool startsWith(const String& prefix) const {return buffer.rfind(prefix.buffer, 0) == 0;}
+    [[nodiscard]] bool endsWith(const String& suffix) const {
+        return buffer.size() >= suffix.buffer.size() &&
+               buffer.compare(buffer.size() - suffix.buffer.size(), suffix.buffer.size(), suffix.buffer) == 0;
+    }
+    [[nodiscard]] int indexOf(const char c, const unsigned int from = 0) const {
+        const size_t pos = buffer.find(c, from);
+        return pos == std::string::npos ? -1 : static_cast<int>(pos);
+    }
+    [[nodiscard]] int indexOf(const String& str, const unsigned int from = 0) const {
+        const size_t pos = buffer.find(str.buffer, from);
+        return pos == std::string::npos ? -1 : static_cast<int>(pos);
+    }
+    [[nodiscard]] String substring(const unsigned int from) const {return from < buffer.size() ? String(buffer.substr(from)) : String();}
+    [[nodiscard]] String substring(const unsigned int from, const unsigned int to) const {
+        if (from >= to || from >= buffer.size()) return String();
+        return String(buffer.substr(from, to - from));
+    }
+    [[nodiscard]] long toInt() const {return strtol(buffer.c_str(), nullptr, 10);}
+    [[nodiscard]] float toFloat() const {return strtof(buffer.c_str(), nullptr);}
+    void trim() {
+        const size_t first = buffer.find_first_not_of(" \t\r\n\f\v");
+        if (first == std::string::npos) {buffer.clear(); return;}
+        const size_t last = buffer.find_last_not_of(" \t\r\n\f\v");
+        buffer = buffer.substr(first, last - first + 1);
+    }
+    void clear() {buffer.clear();}
+
+private:
+    static std::string toBase(unsigned long long value, unsigned char base) {
+        if (base < 2) base = 10;
+        if (value == 0) return "0";
+        std::string digits;
+        while (value) {
+            const unsigned digit = static_cast<unsigned>(value % base);
+            digits.insert(digits.begin(), static_cast<char>(digit < 10 ? '0' + digit : 'a' + digit - 10));
+            value /= base;
+        }
+        return digits;
+    }
+};
+
+
+/** @brief Result type of String concatenation in the Arduino core; libraries may name it */
+class StringSumHelper : public String {
+public:
+    using String::String;
+    StringSumHelper(const String& str) : String(str) {}
+};
+
+
+class Print;
+
+class Printable {
+public:
+    virtual ~Printable() = default;
+    virtual size_t printTo(Print& p) const = 0;
+};
+
+
+class Print {
+public:
+    virtual ~Print() = default;
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size) {
+        size_t n = 0;
+        while (size--) {
+            if (!write(*buffer++)) break;
+            n++;
+        }
+        return n;
+    }
+    size_t write(const char* str) {return str ? write(reinterpret_cast<const uint8_t*>(str), strlen(str)) : 0;}
+    size_t write(const char* buffer, const size_t size) {return write(reinterpret_cast<const uint8_t*>(buffer), size);}
+    virtual int availableForWrite() {return 0;}
+    virtual void flush() {}
+
+    size_t print(const String& s) {return write(s.c_str(), s.length());}
+    size_t print(const char* s) {return write(s);}
+    size_t print(const char c) {return write(static_cast<uint8_t>(c));}
+    size_t print(const Printable& p) {return p.printTo(*this);}
+    template <typename T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
+    size_t print(const T value) {return print(String(value));}
+
+    size_t println() {return write("\r\n");}
+    template <typename T>
+    size_t println(const T& value) {const size_t n = print(value); return n + println();}
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        char stackBuffer[128];
+        va_list args;
+        va_start(args, format);
+        const int length = vsnprintf(stackBuffer, sizeof(stackBuffer), format, args);
+        va_end(args);
+        if (length < 0) return 0;
+        if (static_cast<size_t>(length) < sizeof(stackBuffer)) return write(stackBuffer, length);
+
+        std::string heapBuffer(length + 1, '\0');
+        va_start(args, format);
+        vsnprintf(&heapBuffer[0], heapBuffer.size(), format, args);
+        va_end(args);
+        return write(heapBuffer.c_str(), length);
+    }
+};
+
+
+class Stream : public Print {
+protected:
+    unsigned long _timeout = 1000;
+
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(const unsigned long timeout) {_timeout = timeout;}
+    [[nodiscard]] unsigned long getTimeout() const {return _timeout;}
+
+    virtual size_t readBytes(char* buffer, const size_t length) {
+        size_t count = 0;
+        while (count < length) {
+            const int c = read();
+            if (c < 0) break;
+            *buffer++ = static_cast<char>(c);
+            count++;
+        }
+        return count;
+    }
+    size_t readBytes(uint8_t* buffer, const size_t length) {return readBytes(reinterpret_cast<char*>(buffer), length);}
+
+    String readStringUntil(const char terminator) {
+        String ret;
+        int c = read();
+        while (c >= 0 && c != terminator) {
+            ret += static_cast<char>(c);
+            c = read();
+        }
+        return ret;
+    }
+
+    String readString() {
+        String ret;
+        for (int c = read(); c >= 0; c = read()) ret += static_cast<char>(c);
+        return ret;
+    }
+};
+
+
+/** @brief Serial port stand-in writing to stdout */
+class HostSerial : public Stream {
+public:
+    void begin(unsigned long) {}
+    void end() {}
+    explicit operator bool() const {return true;}
+    int available() override {return 0;}
+    int read() override {return -1;}
+    int peek() override {return -1;}
+    size_t write(const uint8_t c) override {return fputc(c, stdout) == EOF ? 0 : 1;}
+    size_t write(const uint8_t* buffer, const size_t size) override {return fwrite(buffer, 1, size, stdout);}
+    using Print::write;
+    void flush() override {fflush(stdout);}
+};
+
+inline HostSerial Serial;
+
+#endif // NATIVE_ARDUINO_H
@@ -0,0 +1,279 @@
+/**
+ * @file FS.h
+ * @brief Host-side stand-in for the ESP32 fs::FS / fs::File interfaces
+ * @details Files live in an ordinary directory on the workstation and are accessed through
+ *          stdio. Every open, sector transfer and flush is charged to a latency model so
+ *          benchmarks running on the host see SD-card-like cost ratios, and counted in
+ *          IoCounters so they can report the I/O behind each operation.
+ */
+#ifndef NATIVE_FS_H
+#define NATIVE_FS_H
+
+#include <Arduino.h>
+#include <memory>
+#include <sys/stat.h>
+
+#define FILE_READ   "r"
+#define FILE_WRITE  "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+enum SeekMode {SeekSet = 0, SeekCur = 1, SeekEnd = 2};
+
+
+/**
+ * @brief Cost model applied to every card access
+ * @details Defaults approximate a class 10 card on the ESP32 SPI bus. All costs are in
+ *          microseconds and are added to the virtual clock behind micros(). Like FatFs, each
+ *          file handle buffers the sector it last transferred: accesses inside it are free,
+ *          and only the sectors an access moves into are charged.
+ */
+struct LatencyModel {
+    uint32_t openCost = 1500;         // directory walk on FAT
+    uint32_t closeCost = 200;
+    uint32_t sectorReadCost = 250;
+    uint32_t sectorWriteCost = 600;
+    uint32_t flushCost = 2500;        // FAT + directory entry update
+    uint32_t sectorSize = 512;
+    bool sleep = false;               // also block the calling thread for the modeled time
+
+    void charge(const uint32_t cost) const {
+        native::simulatedMicros() += cost;
+        if (sleep && cost) delayMicroseconds(cost);
+    }
+
+    [[nodiscard]] uint32_t sectorsTouched(const size_t position, const size_t length) const {
+        if (length == 0) return 0;
+        return static_cast<uint32_t>((position + length - 1) / sectorSize - position / sectorSize + 1);
+    }
+
+    /**
+     * @brief Sectors an access has to transfer, given the sector a handle has buffered
+     * @param position File offset of the access
+     * @param length Bytes accessed
+     * @param write Whether the access writes
+     * @param sector Buffered sector of the handle, -1 for none; moved to the last one accessed
+     * @param dirty Whether the buffered sector holds unwritten data; updated like sector
+     */
+    [[nodiscard]] uint32_t sectorTransfers(const size_t position, const size_t length, const bool write,
+                                           int64_t& sector, bool& dirty) const {
+        if (length == 0) return 0;
+        const auto first = static_cast<int64_t>(position / sectorSize);
+        const auto last = static_cast<int64_t>((position + length - 1) / sectorSize);
+        // The buffered sector already holds what a read needs, or a write already paid for
+        const bool buffered = first == sector && (!write || dirty);
+        if (first == last && first == sector) {
+            if (buffered) return 0;
+            dirty = true;
+            return 1;
+        }
+        sector = last;
+        dirty = write;
+        return sectorsTouched(position, length) - (buffered ? 1 : 0);
+    }
+
+    /** @brief Process-wide model shared by all stand-in files */
+    static LatencyModel& active() {
+        static LatencyModel model;
+        return model;
+    }
+};
+
+
+/**
+ * @brief Process-wide tally of card accesses made through the stand-in
+ * @details Atomic, as lists with a shared lock policy read from several threads at once.
+ */
+struct IoCounters {
+    std::atomic<uint32_t> opens{0};
+    std::atomic<uint32_t> flushes{0};
+    std::atomic<uint64_t> bytesRead{0};
+    std::atomic<uint64_t> bytesWritten{0};
+
+    static IoCounters& active() {
+        static IoCounters counters;
+        return counters;
+    }
+};
+
+
+class File : public Stream {
+private:
+    struct Handle {
+        FILE* f = nullptr;
+        std::string path;
+        bool dirty = false;
+        int64_t sector = -1;        // buffered sector, see LatencyModel::sectorTransfers()
+        bool sectorDirty = false;
+        ~Handle() {if (f) fclose(f);}
+    };
+    std::shared_ptr<Handle> handle;
+
+    [[nodiscard]] static LatencyModel& model() {return LatencyModel::active();}
+
+    [[nodiscard]] uint32_t transfers(const long position, const size_t length, const bool write) const {
+        return model().sectorTransfers(position, length, write, handle->sector, handle->sectorDirty);
+    }
+
+public:
+    File() = default;
+    File(FILE* f, const std::string& path) : handle(std::make_shared<Handle>()) {
+        handle->f = f;
+        handle->path = path;
+    }
+
+    explicit operator bool() const {return handle && handle->f;}
+
+    size_t write(const uint8_t c) override {return write(&c, 1);}
+    size_t write(const uint8_t* buffer, const size_t size) override {
+        if (!*this || size == 0) return 0;
+        model().charge(transfers(ftell(handle->f), size, true) * model().sectorWriteCost);
+        handle->dirty = true;
+        const size_t n = fwrite(buffer, 1, size, handle->f);
+        IoCounters::active().bytesWritten += n;
+        return n;
+    }
+    using Print::write;
+
+    int available() override {
+        if (!*this) return 0;
+        const long remaining = static_cast<long>(size()) - ftell(handle->f);
+        return remaining > 0 ? static_cast<int>(remaining) : 0;
+    }
+
+    int read() override {
+        uint8_t c;
+        return read(&c, 1) == 1 ? c : -1;
+    }
+
+    size_t read(uint8_t* buffer, const size_t size) {
+        if (!*this || size == 0) return 0;
+        const long position = ftell(handle->f);
+        const size_t n = fread(buffer, 1, size, handle->f);
+        model().charge(transfers(position, n, false) * model().sectorReadCost);
+        IoCounters::active().bytesRead += n;
+        return n;
+    }
+
+    size_t readBytes(char* buffer, const size_t length) override {return read(reinterpret_cast<uint8_t*>(buffer), length);}
+
+    int peek() override {
+        if (!*this) return -1;
+        const long position = ftell(handle->f);
+        const int c = fgetc(handle->f);
+        if (c != EOF) {
+            ungetc(c, handle->f);
+            model().charge(transfers(position, 1, false) * model().sectorReadCost);
+        }
+        return c == EOF ? -1 : c;
+    }
+
+    void flush() override {
+        if (!*this) return;
+        fflush(handle->f);
+        IoCounters::active().flushes++;
+        if (handle->dirty) model().charge(model().flushCost);
+        handle->dirty = false;
+    }
+
+    bool seek(const uint32_t pos, const SeekMode mode) {
+        if (!*this) return false;
+        return fseek(handle->f, pos, mode == SeekSet ? SEEK_SET : mode == SeekCur ? SEEK_CUR : SEEK_END) == 0;
+    }
+    bool seek(const uint32_t pos) {return seek(pos, SeekSet);}
+
+    [[nodiscard]] size_t position() const {return *this ? ftell(handle->f) : 0;}
+
+    [[nodiscard]] size_t size() const {
+        if (!*this) return 0;
+        struct stat st {};
+        return fstat(fileno(handle->f), &st) == 0 ? st.st_size : 0;
+    }
+
+    bool setBufferSize(const size_t size) {return *this && setvbuf(handle->f, nullptr, _IOFBF, size) == 0;}
+
+    /** @brief Closes the underlying file for every copy of this handle, like fs::File on ESP32 */
+    void close() {
+        if (!handle) return;
+        if (handle->f) {
+            fclose(handle->f);
+            handle->f = nullptr;
+            if (handle->dirty) model().charge(model().flushCost);
+            model().charge(model().closeCost);
+        }
+        handle.reset();
+    }
+
+    [[nodiscard]] const char* path() const {return handle ? handle->path.c_str() : "";}
+    [[nodiscard]] const char* name() const {
+        if (!handle) return "";
+        const char* slash = strrchr(handle->path.c_str(), '/');
+        return slash ? slash + 1 : handle->path.c_str();
+    }
+    [[nodiscard]] bool isDirectory() const {return false;}
+};
+
+
+/**
+ * @brief Filesystem rooted at a host directory
+ * @details Paths passed in are card-absolute ("/data.txt") and resolved below root.
+ */
+class FS {
+protected:
+    std::string root = "sd_card";
+
+    [[nodiscard]] std::string resolve(const char* path) const {
+        std::string p = path ? path : "";
+        if (p.empty() || p[0] != '/') p.insert(p.begin(), '/');
+        return root + p;
+    }
+
+public:
+    void setRoot(const std::string& directory) {root = directory;}
+    [[nodiscard]] const std::string& getRoot() const {return root;}
+
+    File open(const char* path, const char* mode = FILE_READ, const bool create = false) {
+        LatencyModel::active().charge(LatencyModel::active().openCost);
+        IoCounters::active().opens++;
+        const std::string resolved = resolve(path);
+        const char* fopenMode = mode;
+        if (strcmp(mode, FILE_READ) == 0) fopenMode = "rb";
+        else if (strcmp(mode, FILE_WRITE) == 0) fopenMode = "wb";
+        else if (strcmp(mode, FILE_APPEND) == 0) fopenMode = "ab";
+        else if (strcmp(mode, "r+") == 0) fopenMode = "rb+";
+        else if (strcmp(mode, "w+") == 0) fopenMode = "wb+";
+        else if (strcmp(mode, "a+") == 0) fopenMode = "ab+";
+        if (create && !exists(path)) fclose(fopen(resolved.c_str(), "wb"));
+        FILE* f = fopen(resolved.c_str(), fopenMode);
+        if (!f) return File();
+        return File(f, path);
+    }
+    File open(const String& path, const char* mode = FILE_READ, const bool create = false) {return open(path.c_str(), mode, create);}
+
+    bool exists(const char* path) const {
+        struct stat st {};
+        return stat(resolve(path).c_str(), &st) == 0;
+    }
+    bool exists(const String& path) const {return exists(path.c_str());}
+
+    bool remove(const char* path) {return ::remove(resolve(path).c_str()) == 0;}
+    bool remove(const String& path) {return remove(path.c_str());}
+
+    bool rename(const char* from, const char* to) {return ::rename(resolve(from).c_str(), resolve(to).c_str()) == 0;}
+    bool rename(const String& from, const String& to) {return rename(from.c_str(), to.c_str());}
+
+    bool mkdir(const char* path) {return ::mkdir(resolve(path).c_str(), 0755) == 0;}
+    bool mkdir(const String& path) {return mkdir(path.c_str());}
+};
+
+} // namespace fs
+
+using fs::FS;
+using fs::File;
+using fs::SeekMode;
+using fs::SeekSet;
+using fs::SeekCur;
+using fs::SeekEnd;
+
+#endif // NATIVE_FS_H
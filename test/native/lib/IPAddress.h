@@ -0,0 +1,24 @@
+/**
+ * @file IPAddress.h
+ * @brief Host-side stand-in for the Arduino IPAddress class
+ * @details Only here because Client.h names it; nothing on the host opens connections.
+ */
+#ifndef NATIVE_IP_ADDRESS_H
+#define NATIVE_IP_ADDRESS_H
+
+#include <Arduino.h>
+
+class IPAddress {
+private:
+    uint8_t octets[4] = {0, 0, 0, 0};
+
+public:
+    IPAddress() = default;
+    IPAddress(const uint8_t a, const uint8_t b, const uint8_t c, const uint8_t d) : octets{a, b, c, d} {}
+
+    uint8_t operator[](const int index) const {return octets[index];}
+    uint8_t& operator[](const int index) {return octets[index];}
+    bool operator==(const IPAddress& rhs) const {return memcmp(octets, rhs.octets, sizeof(octets)) == 0;}
+};
+
+#endif // NATIVE_IP_ADDRESS_H
@@ -0,0 +1,29 @@
+/**
+ * @file SD.h
+ * @brief Host-side stand-in for the ESP32 SD library
+ * @details SD.begin() creates the backing directory (default ./sd_card, or $NATIVE_SD_ROOT).
+ */
+#ifndef NATIVE_SD_H
+#define NATIVE_SD_H
+
+#include <FS.h>
+#include <sys/stat.h>
+
+namespace fs {
+
+class SDFS : public FS {
+public:
+    bool begin() {
+        if (const char* env = getenv("NATIVE_SD_ROOT")) setRoot(env);
+        ::mkdir(getRoot().c_str(), 0755);
+        struct stat st {};
+        return stat(getRoot().c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+    }
+    void end() {}
+};
+
+} // namespace fs
+
+inline fs::SDFS SD;
+
+#endif // NATIVE_SD_H
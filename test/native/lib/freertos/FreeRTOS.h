@@ -0,0 +1,25 @@
+/**
+ * @file FreeRTOS.h
+ * @brief Host-side stand-in for the FreeRTOS base types and macros
+ * @details One tick is one millisecond, as on the Arduino ESP32 core.
+ */
+#ifndef NATIVE_FREERTOS_H
+#define NATIVE_FREERTOS_H
+
+#include <cstdint>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdFAIL 0
+#define pdPASS 1
+#define portMAX_DELAY static_cast<TickType_t>(0xffffffffUL)
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) static_cast<TickType_t>(ms)
+#define tskIDLE_PRIORITY 0
+#define tskNO_AFFINITY 0x7FFFFFFF
+
+#endif // NATIVE_FREERTOS_H
@@ -0,0 +1,89 @@
+/**
+ * @file task.h
+ * @brief Host-side stand-in for FreeRTOS tasks and direct-to-task notifications
+ * @details Each task is a detached std::thread; priority, stack depth and core are
+ *          accepted and ignored. A FreeRTOS task function ends with vTaskDelete(nullptr)
+ *          and never returns; here vTaskDelete(nullptr) does nothing and the thread ends
+ *          when the function returns right after it.
+ */
+#ifndef NATIVE_FREERTOS_TASK_H
+#define NATIVE_FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace native {
+    /** @brief Notification value of one task */
+    struct Task {
+        std::mutex mutex;
+        std::condition_variable notified;
+        uint32_t value = 0;
+        bool pending = false;
+    };
+
+    /** @brief Task the calling thread runs, nullptr for threads not created as tasks */
+    inline Task*& currentTask() {
+        thread_local Task* task = nullptr;
+        return task;
+    }
+}
+
+typedef native::Task* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+inline BaseType_t xTaskCreatePinnedToCore(const TaskFunction_t function, const char* const, const uint32_t,
+                                          void* const parameters, const UBaseType_t, TaskHandle_t* const created,
+                                          const BaseType_t) {
+    auto* task = new native::Task();
+    if (created) *created = task;
+    std::thread([function, parameters, task] {
+        native::currentTask() = task;
+        function(parameters);
+        delete task;
+    }).detach();
+    return pdPASS;
+}
+
+inline void vTaskDelete(const TaskHandle_t) {}
+
+inline void vTaskDelay(const TickType_t ticks) {std::this_thread::sleep_for(std::chrono::milliseconds(ticks));}
+
+#define taskYIELD() std::this_thread::yield()
+
+typedef enum {eNoAction, eSetBits, eIncrement, eSetValueWithOverwrite, eSetValueWithoutOverwrite} eNotifyAction;
+
+inline BaseType_t xTaskNotify(const TaskHandle_t task, const uint32_t value, const eNotifyAction action) {
+    // Signalled under the lock: once woken, an exiting task may delete itself
+    std::lock_guard<std::mutex> lock(task->mutex);
+    switch (action) {
+        case eSetBits: task->value |= value; break;
+        case eIncrement: task->value++; break;
+        case eSetValueWithOverwrite:
+        case eSetValueWithoutOverwrite: task->value = value; break;
+        case eNoAction: break;
+    }
+    task->pending = true;
+    task->notified.notify_one();
+    return pdPASS;
+}
+
+inline BaseType_t xTaskNotifyWait(const uint32_t clearOnEntry, const uint32_t clearOnExit,
+                                  uint32_t* const value, const TickType_t ticksToWait) {
+    native::Task* task = native::currentTask();
+    if (!task) return pdFALSE;
+    std::unique_lock<std::mutex> lock(task->mutex);
+    if (!task->pending) task->value &= ~clearOnEntry;
+    const auto pending = [task] {return task->pending;};
+    if (ticksToWait == portMAX_DELAY) task->notified.wait(lock, pending);
+    else task->notified.wait_for(lock, std::chrono::milliseconds(ticksToWait), pending);
+    if (value) *value = task->value;
+    if (!task->pending) return pdFALSE;
+    task->pending = false;
+    task->value &= ~clearOnExit;
+    return pdTRUE;
+}
+
+#endif // NATIVE_FREERTOS_TASK_H
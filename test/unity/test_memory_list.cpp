@@ -5,6 +5,31 @@
 
 MemoryList* testList;
 
+// Heap allocation counter, fed by the -Wl,--wrap linker flags of [env:test] and [env:native]
+std::atomic<size_t> heapAllocations{0};
+#ifdef MEMORY_LIST_COUNT_HEAP
+extern "C" {
+    void* __real_malloc(size_t size);
+    void* __real_calloc(size_t count, size_t size);
+    void* __real_realloc(void* ptr, size_t size);
+    void __real_free(void* ptr);
+    void* __wrap_malloc(size_t size) {heapAllocations++; return __real_malloc(size);}
+    void* __wrap_calloc(size_t count, size_t size) {heapAllocations++; return __real_calloc(count, size);}
+    void* __wrap_realloc(void* ptr, size_t size) {heapAllocations++; return __real_realloc(ptr, size);}
+    void __wrap_free(void* ptr) {__real_free(ptr);}
+}
+#ifdef MEMORY_LIST_NATIVE
+#include <new>
+// The host String stand-in allocates through operator new, which the wrap does not reach
+void* operator new(size_t size) {
+    if (void* memory = __wrap_malloc(size ? size : 1)) return memory;
+    throw std::bad_alloc();
+}
+void operator delete(void* memory) noexcept {__wrap_free(memory);}
+void operator delete(void* memory, size_t) noexcept {__wrap_free(memory);}
+#endif
+#endif
+
 void setUp(void) {
     SD.begin();
     testList = new MemoryList("/test.txt");
@@ -122,6 +147,29 @@ void test_defragmentation_should_reduce_fragmentation(void) {
     TEST_ASSERT_TRUE(fragAfter < fragBefore);
 }
 
+void test_fragmentation_counters_should_track_removals(void) {
+    for(int i = 0; i < 4; i++) {
+        JsonDocument doc;
+        doc["test"] = "item" + String(i);
+        testList->push(doc.as<JsonObjectConst>());
+    }
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, testList->getFragmentationRatio());
+
+    testList->remove(2);
+    TEST_ASSERT_EQUAL_FLOAT(0.25f, testList->getFragmentationRatio());
+    testList->removeFirst(1);
+    TEST_ASSERT_EQUAL_FLOAT(0.5f, testList->getFragmentationRatio());
+
+    JsonDocument stats = testList->getStats();
+    TEST_ASSERT_EQUAL(SD.open("/test.txt").size(), stats["fileSize"].as<size_t>());
+    TEST_ASSERT_EQUAL(stats["fileSize"].as<size_t>() / 2, stats["deadBytes"].as<size_t>());
+
+    // Counters are seeded from the file when it is reopened
+    MemoryList reopened("/test.txt");
+    TEST_ASSERT_EQUAL_FLOAT(0.5f, reopened.getFragmentationRatio());
+    TEST_ASSERT_EQUAL(2, reopened.size());
+}
+
 
 // Add these test functions:
 
@@ -192,7 +240,1100 @@ void test_large_file_operations(void) {
     TEST_ASSERT_EQUAL(10, testList->size());
 }
 
-void RUN_UNITY_TESTS() {
+// Index Tests
+MemoryListConfig indexedConfig() {
+    MemoryListConfig config;
+    config.useIndex = true;
+    return config;
+}
+
+String itemString(int i) {
+    JsonDocument doc;
+    doc["test"] = "item" + String(i);
+    String out;
+    serializeJson(doc, out);
+    return out;
+}
+
+void pushItems(MemoryList& list, int count) {
+    for(int i = 0; i < count; i++) {
+        JsonDocument doc;
+        doc["test"] = "item" + String(i);
+        list.push(doc.as<JsonObjectConst>());
+    }
+}
+
+void test_index_get_should_return_element_at_index(void) {
+    MemoryList indexed("/test_index.txt", indexedConfig());
+    indexed.clear();
+    pushItems(indexed, 20);
+
+    TEST_ASSERT_EQUAL(20, indexed.size());
+    TEST_ASSERT_EQUAL_STRING(itemString(0).c_str(), indexed.get(0).c_str());
+    TEST_ASSERT_EQUAL_STRING(itemString(13).c_str(), indexed.get(13).c_str());
+    TEST_ASSERT_EQUAL_STRING(itemString(19).c_str(), indexed.getLast().c_str());
+}
+
+void test_index_should_follow_remove_and_removeFirst(void) {
+    MemoryList indexed("/test_index.txt", indexedConfig());
+    indexed.clear();
+    pushItems(indexed, 10);
+
+    TEST_ASSERT_EQUAL_STRING(itemString(7).c_str(), indexed.remove(7).c_str());
+    TEST_ASSERT_EQUAL_STRING(itemString(1).c_str(), indexed.remove(1).c_str());
+    TEST_ASSERT_EQUAL(2, indexed.removeFirst(2));
+
+    // remaining: 3 4 5 6 8 9
+    TEST_ASSERT_EQUAL(6, indexed.size());
+    TEST_ASSERT_EQUAL_STRING(itemString(3).c_str(), indexed.get(0).c_str());
+    TEST_ASSERT_EQUAL_STRING(itemString(6).c_str(), indexed.get(3).c_str());
+    TEST_ASSERT_EQUAL_STRING(itemString(8).c_str(), indexed.get(4).c_str());
+    TEST_ASSERT_EQUAL_STRING(itemString(9).c_str(), indexed.getLast().c_str());
+
+    TEST_ASSERT_TRUE(indexed.defragment());
+    TEST_ASSERT_EQUAL_STRING(itemString(5).c_str(), indexed.get(2).c_str());
+    TEST_ASSERT_EQUAL_STRING(itemString(9).c_str(), indexed.get(5).c_str());
+}
+
+void test_index_should_be_rebuilt_when_corrupt(void) {
+    {
+        MemoryList indexed("/test_index.txt", indexedConfig());
+        indexed.clear();
+        pushItems(indexed, 5);
+    }
+
+    File indexFile = SD.open("/test_index.txt.idx", FILE_WRITE);
+    indexFile.print("garbage");
+    indexFile.close();
+
+    MemoryList reopened("/test_index.txt", indexedConfig());
+    TEST_ASSERT_EQUAL(5, reopened.size());
+    TEST_ASSERT_EQUAL_STRING(itemString(2).c_str(), reopened.get(2).c_str());
+    TEST_ASSERT_EQUAL_STRING(itemString(4).c_str(), reopened.getLast().c_str());
+}
+
+// Session Mode Tests
+void test_session_should_persist_across_reopen(void) {
+    MemoryListConfig config;
+    config.keepOpen = true;
+    {
+        MemoryList session("/test_session.txt", config);
+        session.clear();
+        pushItems(session, 6);
+
+        TEST_ASSERT_EQUAL_STRING(itemString(5).c_str(), session.getLast().c_str());
+        TEST_ASSERT_EQUAL_STRING(itemString(2).c_str(), session.remove(2).c_str());
+        TEST_ASSERT_TRUE(session.defragment());
+        TEST_ASSERT_EQUAL_STRING(itemString(3).c_str(), session.get(2).c_str());
+        pushItems(session, 1);
+    }
+
+    MemoryList reopened("/test_session.txt");
+    TEST_ASSERT_EQUAL(6, reopened.size());
+    TEST_ASSERT_EQUAL_STRING(itemString(0).c_str(), reopened.getLast().c_str());
+}
+
+// State Tests
+MemoryListConfig stateConfig() {
+    MemoryListConfig config;
+    config.persistState = true;
+    return config;
+}
+
+// Word offsets into the metadata record
+constexpr size_t META_CLEAN = 1;
+constexpr size_t META_COUNT = 3;
+constexpr size_t META_HEAD = 6;
+constexpr size_t META_WORDS = 11;
+
+void readMeta(uint32_t* words) {
+    File metaFile = SD.open("/test_state.txt.meta");
+    metaFile.read(reinterpret_cast<uint8_t*>(words), META_WORDS * sizeof(uint32_t));
+    metaFile.close();
+}
+
+void test_state_should_survive_reopen(void) {
+    {
+        MemoryList fifo("/test_state.txt", stateConfig());
+        fifo.clear();
+        pushItems(fifo, 10);
+        TEST_ASSERT_EQUAL(3, fifo.removeFirst(3));
+        TEST_ASSERT_EQUAL_STRING(itemString(3).c_str(), fifo.remove(0).c_str());
+        TEST_ASSERT_EQUAL_STRING(itemString(4).c_str(), fifo.get(0).c_str());
+    }
+
+    // Closed cleanly, with the head just past the four removed records
+    uint32_t meta[META_WORDS] = {};
+    readMeta(meta);
+    TEST_ASSERT_EQUAL(1, meta[META_CLEAN]);
+    TEST_ASSERT_EQUAL(6, meta[META_COUNT]);
+    TEST_ASSERT_EQUAL(4 * (itemString(0).length() + 2), meta[META_HEAD]);
+
+    MemoryList reopened("/test_state.txt", stateConfig());
+    TEST_ASSERT_EQUAL(6, reopened.size());
+    TEST_ASSERT_EQUAL_STRING(itemString(4).c_str(), reopened.get(0).c_str());
+    TEST_ASSERT_EQUAL_STRING(itemString(9).c_str(), reopened.getLast().c_str());
+    TEST_ASSERT_EQUAL(2, reopened.removeFirst(2));
+    TEST_ASSERT_EQUAL_STRING(itemString(6).c_str(), reopened.get(0).c_str());
+}
+
+void test_state_should_be_ignored_when_corrupt(void) {
+    {
+        MemoryList fifo("/test_state.txt", stateConfig());
+        fifo.clear();
+        pushItems(fifo, 5);
+        fifo.removeFirst(1);
+    }
+
+    // Change the count without fixing the checksum
+    uint32_t meta[META_WORDS] = {};
+    readMeta(meta);
+    meta[META_COUNT] = 40;
+    File metaFile = SD.open("/test_state.txt.meta", FILE_WRITE);
+    metaFile.write(reinterpret_cast<const uint8_t*>(meta), sizeof(meta));
+    metaFile.close();
+
+    MemoryList reopened("/test_state.txt", stateConfig());
+    TEST_ASSERT_EQUAL(4, reopened.size());
+    TEST_ASSERT_EQUAL_STRING(itemString(1).c_str(), reopened.get(0).c_str());
+}
+
+void test_state_should_be_rescanned_after_reset(void) {
+    // Never destroyed, like a device that resets without closing the list
+    auto* fifo = new MemoryList("/test_state.txt", stateConfig());
+    fifo->clear();
+    pushItems(*fifo, 5);
+    fifo->sync();
+    fifo->removeFirst(2);
+    pushItems(*fifo, 1);
+
+    uint32_t meta[META_WORDS] = {};
+    readMeta(meta);
+    TEST_ASSERT_EQUAL(0, meta[META_CLEAN]);
+
+    MemoryList reopened("/test_state.txt", stateConfig());
+    TEST_ASSERT_EQUAL(4, reopened.size());
+    TEST_ASSERT_EQUAL_STRING(itemString(2).c_str(), reopened.get(0).c_str());
+    TEST_ASSERT_EQUAL_STRING(itemString(0).c_str(), reopened.getLast().c_str());
+}
+
+// Zero-Allocation Read Tests
+void test_get_into_buffer_should_not_allocate(void) {
+#ifndef MEMORY_LIST_COUNT_HEAP
+    TEST_IGNORE_MESSAGE("Heap counting needs MEMORY_LIST_COUNT_HEAP and the --wrap linker flags");
+#endif
+    for (const bool useIndex : {false, true}) {
+        MemoryListConfig config;
+        config.keepOpen = true;
+        config.useIndex = useIndex;
+        MemoryList session("/test_session.txt", config);
+        session.clear();
+        pushItems(session, 10);
+        session.remove(3);
+
+        char element[32];
+        char last[32];
+        const size_t before = heapAllocations;
+        const size_t elementLength = session.get(6, element, sizeof(element));
+        const size_t lastLength = session.getLast(last, sizeof(last));
+        TEST_ASSERT_EQUAL(before, heapAllocations);
+
+        TEST_ASSERT_EQUAL(itemString(7).length(), elementLength);
+        TEST_ASSERT_EQUAL_STRING(itemString(7).c_str(), element);
+        TEST_ASSERT_EQUAL(itemString(9).length(), lastLength);
+        TEST_ASSERT_EQUAL_STRING(itemString(9).c_str(), last);
+    }
+}
+
+void test_get_into_buffer_should_reject_small_buffer(void) {
+    pushItems(*testList, 2);
+    char small[8];
+    TEST_ASSERT_EQUAL(0, testList->get(1, small, sizeof(small)));
+    TEST_ASSERT_EQUAL_STRING("", small);
+}
+
+void test_get_into_document_should_parse_element(void) {
+    pushItems(*testList, 5);
+    testList->removeFirst(1);
+
+    JsonDocument doc;
+    TEST_ASSERT_TRUE(testList->get(2, doc));
+    TEST_ASSERT_EQUAL_STRING("item3", doc["test"].as<const char*>());
+    TEST_ASSERT_TRUE(testList->getLast(doc));
+    TEST_ASSERT_EQUAL_STRING("item4", doc["test"].as<const char*>());
+    TEST_ASSERT_FALSE(testList->get(4, doc));
+}
+
+// Streaming Push Tests
+void test_push_should_stream_large_element(void) {
+    for (const size_t writeBufferSize : {size_t(0), size_t(64)}) {
+        MemoryListConfig config;
+        config.keepOpen = true;
+        config.writeBufferSize = writeBufferSize;
+        MemoryList session("/test_session.txt", config);
+        session.clear();
+
+        String largeValue;
+        for(int i = 0; i < 2000; i++) largeValue += char('a' + i % 26);
+        JsonDocument doc;
+        doc["large"] = largeValue;
+
+        const size_t before = heapAllocations;
+        TEST_ASSERT_TRUE(session.push(doc.as<JsonObjectConst>()));
+#ifdef MEMORY_LIST_COUNT_HEAP
+        // At most the write buffer itself, whatever the record size
+        TEST_ASSERT_EQUAL(writeBufferSize ? 1 : 0, heapAllocations - before);
+#endif
+        pushItems(session, 1);
+
+        String expected;
+        serializeJson(doc, expected);
+        TEST_ASSERT_EQUAL_STRING(expected.c_str(), session.get(0).c_str());
+        TEST_ASSERT_EQUAL_STRING(itemString(0).c_str(), session.getLast().c_str());
+    }
+}
+
+// Batch Tests
+void test_pushBatch_should_append_all_elements(void) {
+    MemoryList indexed("/test_index.txt", indexedConfig());
+    indexed.clear();
+    pushItems(indexed, 2);
+
+    // Enough records to span several buffers, plus one larger than the buffer
+    JsonDocument batch;
+    for(int i = 2; i < 60; i++) {
+        batch.add<JsonObject>()["test"] = "item" + String(i);
+    }
+    String largeValue;
+    for(int i = 0; i < 600; i++) largeValue += 'x';
+    batch.add<JsonObject>()["large"] = largeValue;
+    batch.add<JsonObject>()["test"] = "item61";
+
+    TEST_ASSERT_EQUAL(60, indexed.pushBatch(batch.as<JsonArrayConst>()));
+    TEST_ASSERT_EQUAL(62, indexed.size());
+    TEST_ASSERT_EQUAL_STRING(itemString(1).c_str(), indexed.get(1).c_str());
+    TEST_ASSERT_EQUAL_STRING(itemString(37).c_str(), indexed.get(37).c_str());
+    TEST_ASSERT_EQUAL_STRING(itemString(61).c_str(), indexed.getLast().c_str());
+
+    MemoryList reopened("/test_index.txt");
+    TEST_ASSERT_EQUAL(62, reopened.size());
+    TEST_ASSERT_EQUAL_STRING(itemString(59).c_str(), reopened.get(59).c_str());
+    TEST_ASSERT_EQUAL(600, reopened.get(60).length() - 12);
+}
+
+void test_removeFirst_should_cap_a_call_at_uint16_max(void) {
+    MemoryList fifo("/test_remove_first_large.txt");
+    fifo.clear();
+    constexpr int TOTAL = 70010;
+    for (int first = 0; first < TOTAL; first += 1000) {
+        JsonDocument batch;
+        for (int i = first; i < min(first + 1000, TOTAL); i++) batch.add<JsonObject>()["n"] = i;
+        TEST_ASSERT_EQUAL(batch.size(), fifo.pushBatch(batch.as<JsonArrayConst>()));
+    }
+
+    // The count returned must match what was tombstoned
+    TEST_ASSERT_EQUAL(UINT16_MAX, fifo.removeFirst(TOTAL));
+    TEST_ASSERT_EQUAL(TOTAL - UINT16_MAX, fifo.size());
+    TEST_ASSERT_EQUAL(fifo.size(), fifo.calcSize());
+    JsonDocument doc;
+    TEST_ASSERT_TRUE(fifo.get(0, doc));
+    TEST_ASSERT_EQUAL(UINT16_MAX, doc["n"].as<int>());
+
+    TEST_ASSERT_EQUAL(TOTAL - UINT16_MAX, fifo.removeFirst(TOTAL));
+    TEST_ASSERT_EQUAL(0, fifo.size());
+    TEST_ASSERT_EQUAL(0, fifo.calcSize());
+}
+
+// Construction Scan Tests
+void test_reopen_should_restore_derived_state(void) {
+    pushItems(*testList, 12);
+    JsonDocument doc;
+    doc["test"] = "a much longer item than the others";
+    testList->push(doc.as<JsonObjectConst>());
+    testList->removeFirst(2);
+    testList->remove(4);
+    JsonDocument before = testList->getStats();
+
+    MemoryList reopened("/test.txt");
+    JsonDocument after = reopened.getStats();
+    TEST_ASSERT_EQUAL(before["size"].as<size_t>(), after["size"].as<size_t>());
+    TEST_ASSERT_EQUAL(before["liveBytes"].as<size_t>(), after["liveBytes"].as<size_t>());
+    TEST_ASSERT_EQUAL(before["deadBytes"].as<size_t>(), after["deadBytes"].as<size_t>());
+    TEST_ASSERT_EQUAL(measureJson(doc) + 2, after["maxRecordLength"].as<size_t>());
+
+    String expected;
+    serializeJson(doc, expected);
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), reopened.getLast().c_str());
+    TEST_ASSERT_EQUAL_STRING(itemString(2).c_str(), reopened.get(0).c_str());
+}
+
+// Tail Tests
+void test_getLast_should_follow_tail_changes(void) {
+    pushItems(*testList, 6);
+    TEST_ASSERT_EQUAL_STRING(itemString(5).c_str(), testList->getLast().c_str());
+
+    // Removing the tail drops the cached offset; the next call finds item4
+    testList->remove(5);
+    TEST_ASSERT_EQUAL_STRING(itemString(4).c_str(), testList->getLast().c_str());
+    testList->remove(4);
+    testList->remove(3);
+    TEST_ASSERT_EQUAL_STRING(itemString(2).c_str(), testList->getLast().c_str());
+
+    TEST_ASSERT_TRUE(testList->defragment());
+    TEST_ASSERT_EQUAL_STRING(itemString(2).c_str(), testList->getLast().c_str());
+
+    JsonDocument batch;
+    batch.add<JsonObject>()["test"] = "item8";
+    batch.add<JsonObject>()["test"] = "item9";
+    TEST_ASSERT_EQUAL(2, testList->pushBatch(batch.as<JsonArrayConst>()));
+    TEST_ASSERT_EQUAL_STRING(itemString(9).c_str(), testList->getLast().c_str());
+
+    testList->removeFirst(5);
+    TEST_ASSERT_EQUAL_STRING("", testList->getLast().c_str());
+}
+
+// I/O Counter Tests
+size_t statDelta(JsonDocument& before, JsonDocument& after, const char* key) {
+    return after[key].as<size_t>() - before[key].as<size_t>();
+}
+
+void test_io_stats_should_count_hot_paths(void) {
+#ifndef MEMORY_LIST_IO_STATS
+    TEST_IGNORE_MESSAGE("I/O counters need MEMORY_LIST_IO_STATS");
+#endif
+    JsonDocument doc;
+    doc["test"] = "counted";
+    const size_t recordLength = measureJson(doc) + 2;
+
+    JsonDocument before = testList->getStats();
+    TEST_ASSERT_TRUE(testList->push(doc.as<JsonObjectConst>()));
+    JsonDocument after = testList->getStats();
+    TEST_ASSERT_EQUAL(1, statDelta(before, after, "opens"));
+    TEST_ASSERT_EQUAL(recordLength, statDelta(before, after, "bytesWritten"));
+    TEST_ASSERT_GREATER_OR_EQUAL(recordLength, after["largestRecord"].as<size_t>());
+
+    before = after;
+    TEST_ASSERT_FALSE(testList->getLast().isEmpty());
+    after = testList->getStats();
+    TEST_ASSERT_EQUAL(1, statDelta(before, after, "opens"));
+    TEST_ASSERT_GREATER_OR_EQUAL(recordLength, statDelta(before, after, "bytesRead"));
+    TEST_ASSERT_EQUAL(0, statDelta(before, after, "bytesWritten"));
+
+    // Removing the only record leaves nothing but dead bytes, which triggers a defragment
+    before = after;
+    TEST_ASSERT_FALSE(testList->remove(0).isEmpty());
+    after = testList->getStats();
+    TEST_ASSERT_EQUAL(1, statDelta(before, after, "bytesWritten"));
+    TEST_ASSERT_EQUAL(1, statDelta(before, after, "defragmentRuns"));
+    TEST_ASSERT_GREATER_THAN(0, statDelta(before, after, "seeks"));
+}
+
+// Incremental Defragmentation Tests
+void test_defragmentStep_should_compact_incrementally(void) {
+    MemoryListConfig config = indexedConfig();
+    config.autoDefragment = false;
+    MemoryList fifo("/test_steps.txt", config);
+    fifo.clear();
+    pushItems(fifo, 20);
+    TEST_ASSERT_FALSE(fifo.defragmentStep(64));
+
+    fifo.removeFirst(2);
+    fifo.remove(0);
+    TEST_ASSERT_TRUE(fifo.defragmentStep(32));
+
+    // The list stays usable between steps, including for records already copied
+    JsonDocument doc;
+    doc["test"] = "item20";
+    TEST_ASSERT_TRUE(fifo.push(doc.as<JsonObjectConst>()));
+    TEST_ASSERT_EQUAL_STRING(itemString(3).c_str(), fifo.remove(0).c_str());
+    TEST_ASSERT_EQUAL_STRING(itemString(4).c_str(), fifo.get(0).c_str());
+
+    int steps = 1;
+    while (fifo.defragmentStep(32)) steps++;
+    TEST_ASSERT_GREATER_THAN(2, steps);
+    TEST_ASSERT_EQUAL(17, fifo.size());
+    for (int i = 0; i < 17; i++) TEST_ASSERT_EQUAL_STRING(itemString(i + 4).c_str(), fifo.get(i).c_str());
+    TEST_ASSERT_EQUAL_STRING(itemString(20).c_str(), fifo.getLast().c_str());
+
+    // Only the record removed after it was copied is left as dead bytes
+    JsonDocument stats = fifo.getStats();
+    TEST_ASSERT_EQUAL(itemString(3).length() + 2, stats["deadBytes"].as<size_t>());
+    TEST_ASSERT_EQUAL(SD.open("/test_steps.txt").size(), stats["fileSize"].as<size_t>());
+    TEST_ASSERT_FALSE(SD.exists("/test_steps.txt.tmp"));
+
+    MemoryList reopened("/test_steps.txt", config);
+    TEST_ASSERT_EQUAL(17, reopened.size());
+    TEST_ASSERT_EQUAL_FLOAT(fifo.getFragmentationRatio(), reopened.getFragmentationRatio());
+}
+
+// Background Compaction Tests
+void test_background_compaction_should_run_alongside_operations(void) {
+    MemoryListConfig config;
+    config.backgroundCompaction = true;
+    config.compactionStepBytes = 64;
+    MemoryList fifo("/test_background.txt", config);
+    fifo.clear();
+    pushItems(fifo, 40);
+
+    // Crossing the threshold wakes the task; the list keeps serving this one meanwhile
+    TEST_ASSERT_EQUAL(30, fifo.removeFirst(30));
+    for (int i = 40; i < 60; i++) {
+        JsonDocument doc;
+        doc["test"] = "item" + String(i);
+        TEST_ASSERT_TRUE(fifo.push(doc.as<JsonObjectConst>()));
+        TEST_ASSERT_EQUAL_STRING(itemString(30).c_str(), fifo.get(0).c_str());
+    }
+
+    const unsigned long started = millis();
+    while (fifo.getFragmentationRatio() > 0.0f && millis() - started < 5000) delay(5);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, fifo.getFragmentationRatio());
+    TEST_ASSERT_EQUAL(30, fifo.size());
+    for (int i = 0; i < 30; i++) TEST_ASSERT_EQUAL_STRING(itemString(i + 30).c_str(), fifo.get(i).c_str());
+    TEST_ASSERT_EQUAL_STRING(itemString(59).c_str(), fifo.getLast().c_str());
+}
+
+// Concurrency Tests
+using SharedList = BasicMemoryList<ReadWriteLock>;
+
+constexpr int STRESS_WRITERS = 3;
+constexpr int STRESS_PUSHES = 60;
+constexpr int STRESS_READERS = 2;
+
+struct StressRun {
+    SharedList* list = nullptr;
+    std::atomic<int> nextWriter{0};
+    std::atomic<int> writersDone{0};
+    std::atomic<int> tasksDone{0};
+    std::atomic<int> removed{0};
+    std::atomic<int> badReads{0};
+};
+
+bool isStressRecord(const String& record) {
+    JsonDocument doc;
+    return !deserializeJson(doc, record) && doc["w"].is<int>() && doc["n"].is<int>();
+}
+
+void stressWriter(void* arg) {
+    auto* run = static_cast<StressRun*>(arg);
+    const int writer = run->nextWriter++;
+    for (int i = 0; i < STRESS_PUSHES; i++) {
+        JsonDocument doc;
+        doc["w"] = writer;
+        doc["n"] = i;
+        run->list->push(doc.as<JsonObjectConst>());
+        if (i % 2 == 0) run->removed += run->list->removeFirst(1);
+    }
+    run->writersDone++;
+    run->tasksDone++;
+    vTaskDelete(nullptr);
+}
+
+void stressReader(void* arg) {
+    auto* run = static_cast<StressRun*>(arg);
+    while (run->writersDone < STRESS_WRITERS) {
+        const String last = run->list->getLast();
+        if (!last.isEmpty() && !isStressRecord(last)) run->badReads++;
+        const String first = run->list->get(0);
+        if (!first.isEmpty() && !isStressRecord(first)) run->badReads++;
+    }
+    run->tasksDone++;
+    vTaskDelete(nullptr);
+}
+
+void test_concurrent_writers_and_readers_should_not_corrupt(void) {
+    SharedList list("/test_stress.txt", indexedConfig());
+    list.clear();
+    StressRun run;
+    run.list = &list;
+    for (int i = 0; i < STRESS_WRITERS; i++) xTaskCreatePinnedToCore(stressWriter, "writer", 8192, &run, 1, nullptr, tskNO_AFFINITY);
+    for (int i = 0; i < STRESS_READERS; i++) xTaskCreatePinnedToCore(stressReader, "reader", 8192, &run, 1, nullptr, tskNO_AFFINITY);
+    while (run.tasksDone < STRESS_WRITERS + STRESS_READERS) vTaskDelay(1);
+
+    // No lost updates of the size, and the file agrees with it
+    const size_t expected = STRESS_WRITERS * STRESS_PUSHES - run.removed;
+    TEST_ASSERT_EQUAL(0, run.badReads.load());
+    TEST_ASSERT_EQUAL(expected, list.size());
+    TEST_ASSERT_EQUAL(expected, list.calcSize());
+
+    // Every record is intact and each writer's records are still in push order
+    int lastSeen[STRESS_WRITERS] = {-1, -1, -1};
+    for (size_t i = 0; i < expected; i++) {
+        JsonDocument doc;
+        TEST_ASSERT_TRUE(list.get(i, doc));
+        const int writer = doc["w"];
+        TEST_ASSERT_GREATER_THAN(lastSeen[writer], doc["n"].as<int>());
+        lastSeen[writer] = doc["n"];
+    }
+}
+
+// Ingest Ring Tests
+constexpr int INGEST_PRODUCERS = 3;
+constexpr int INGEST_RECORDS = 40;
+
+MemoryListConfig ingestConfig(const size_t highWatermark) {
+    MemoryListConfig config = indexedConfig();
+    config.ingestSlots = 8;
+    config.ingestSlotSize = 32;
+    config.ingestHighWatermark = highWatermark;
+    return config;
+}
+
+struct IngestRun {
+    MemoryList* list = nullptr;
+    std::atomic<int> nextProducer{0};
+    std::atomic<int> producersDone{0};
+};
+
+void ingestProducer(void* arg) {
+    auto* run = static_cast<IngestRun*>(arg);
+    const int producer = run->nextProducer++;
+    for (int i = 0; i < INGEST_RECORDS; i++) {
+        JsonDocument doc;
+        doc["p"] = producer;
+        doc["n"] = i;
+        while (!run->list->enqueue(doc.as<JsonObjectConst>())) vTaskDelay(1);
+    }
+    run->producersDone++;
+    vTaskDelete(nullptr);
+}
+
+void test_enqueue_should_reach_file_in_order_per_producer(void) {
+    MemoryList list("/test_ingest.txt", ingestConfig(4));
+    list.clear();
+    IngestRun run;
+    run.list = &list;
+    for (int i = 0; i < INGEST_PRODUCERS; i++) xTaskCreatePinnedToCore(ingestProducer, "producer", 8192, &run, 1, nullptr, tskNO_AFFINITY);
+    while (run.producersDone < INGEST_PRODUCERS) vTaskDelay(1);
+    list.flush();
+
+    const size_t expected = INGEST_PRODUCERS * INGEST_RECORDS;
+    TEST_ASSERT_EQUAL(expected, list.size());
+    TEST_ASSERT_EQUAL(expected, list.calcSize());
+    int lastSeen[INGEST_PRODUCERS] = {-1, -1, -1};
+    for (size_t i = 0; i < expected; i++) {
+        JsonDocument doc;
+        TEST_ASSERT_TRUE(list.get(i, doc));
+        const int producer = doc["p"];
+        TEST_ASSERT_EQUAL(lastSeen[producer] + 1, doc["n"].as<int>());
+        lastSeen[producer] = doc["n"];
+    }
+}
+
+void test_enqueue_should_count_overflows(void) {
+    // Watermark 0 keeps the task from draining, so the ring fills up
+    MemoryList list("/test_ingest.txt", ingestConfig(0));
+    list.clear();
+    pushItems(list, 2);
+    for (int i = 0; i < 8; i++) {
+        JsonDocument doc;
+        doc["test"] = "item" + String(i + 2);
+        TEST_ASSERT_TRUE(list.enqueue(doc.as<JsonObjectConst>()));
+    }
+    JsonDocument extra;
+    extra["test"] = "extra";
+    TEST_ASSERT_FALSE(list.enqueue(extra.as<JsonObjectConst>()));
+    extra["test"] = "longer than any slot of the ring";
+    TEST_ASSERT_FALSE(list.enqueue(extra.as<JsonObjectConst>()));
+
+    JsonDocument stats = list.getStats();
+    TEST_ASSERT_EQUAL(8, stats["ingestQueued"].as<int>());
+    TEST_ASSERT_EQUAL(2, stats["ingestOverflows"].as<int>());
+    TEST_ASSERT_EQUAL(2, list.size());
+
+    TEST_ASSERT_EQUAL(8, list.flush());
+    TEST_ASSERT_EQUAL(10, list.size());
+    TEST_ASSERT_EQUAL_STRING(itemString(9).c_str(), list.getLast().c_str());
+    stats = list.getStats();
+    TEST_ASSERT_EQUAL(0, stats["ingestQueued"].as<int>());
+}
+
+void test_enqueue_should_drain_a_small_ring_without_flush(void) {
+    // Both watermarks are past what a 16-slot ring holds
+    MemoryListConfig config = indexedConfig();
+    config.ingestSlots = 16;
+    config.ingestSlotSize = 32;
+    config.ingestLowWatermark = 100;
+    MemoryList list("/test_ingest.txt", config);
+    list.clear();
+    for (int i = 0; i < 16; i++) {
+        JsonDocument doc;
+        doc["test"] = "item" + String(i);
+        TEST_ASSERT_TRUE(list.enqueue(doc.as<JsonObjectConst>()));
+    }
+
+    // The task drains down to one below the high watermark
+    for (int wait = 0; wait < 1000 && list.size() == 0; wait++) vTaskDelay(1);
+    TEST_ASSERT_EQUAL(1, list.size());
+    TEST_ASSERT_EQUAL_STRING(itemString(0).c_str(), list.getLast().c_str());
+    JsonDocument stats = list.getStats();
+    TEST_ASSERT_EQUAL(15, stats["ingestQueued"].as<int>());
+    TEST_ASSERT_EQUAL(0, stats["ingestOverflows"].as<int>());
+}
+
+void test_ingest_list_should_not_compact_when_opened(void) {
+    {
+        MemoryListConfig config;
+        config.autoDefragment = false;
+        MemoryList fifo("/test_ingest.txt", config);
+        fifo.clear();
+        pushItems(fifo, 10);
+        TEST_ASSERT_EQUAL(9, fifo.removeFirst(9));
+    }
+
+    // Like a plain list, one with a ring and a task leaves the file as it is
+    MemoryListConfig config;
+    config.ingestSlots = 4;
+    MemoryList reopened("/test_ingest.txt", config);
+    TEST_ASSERT_TRUE(reopened.getFragmentationRatio() > 0.7f);
+    TEST_ASSERT_EQUAL(1, reopened.size());
+    TEST_ASSERT_EQUAL_STRING(itemString(9).c_str(), reopened.getLast().c_str());
+}
+
+// Binary Format Tests
+MemoryListConfig binaryConfig() {
+    MemoryListConfig config;
+    config.format = RecordFormat::Binary;
+    return config;
+}
+
+int firstFileByte(const char* path) {
+    File file = SD.open(path, FILE_READ);
+    const int first = file.read();
+    file.close();
+    return first;
+}
+
+void test_binary_format_should_support_every_operation(void) {
+    {
+        MemoryList fifo("/test_binary.txt", binaryConfig());
+        fifo.clear();
+        pushItems(fifo, 6);
+        JsonDocument batch;
+        batch.add<JsonObject>()["test"] = "item6";
+        batch.add<JsonObject>()["test"] = "item7";
+        TEST_ASSERT_EQUAL(2, fifo.pushBatch(batch.as<JsonArrayConst>()));
+        TEST_ASSERT_EQUAL(0xB0, firstFileByte("/test_binary.txt") & 0xF0);
+
+        TEST_ASSERT_EQUAL_STRING(itemString(2).c_str(), fifo.remove(2).c_str());
+        TEST_ASSERT_EQUAL(1, fifo.removeFirst(1));
+        TEST_ASSERT_EQUAL(6, fifo.size());
+        TEST_ASSERT_EQUAL(6, fifo.calcSize());
+        TEST_ASSERT_EQUAL_STRING(itemString(3).c_str(), fifo.get(1).c_str());
+        TEST_ASSERT_EQUAL_STRING(itemString(7).c_str(), fifo.getLast().c_str());
+
+        char buffer[32];
+        TEST_ASSERT_EQUAL(itemString(4).length(), fifo.get(2, buffer, sizeof(buffer)));
+        TEST_ASSERT_EQUAL_STRING(itemString(4).c_str(), buffer);
+        JsonDocument doc;
+        TEST_ASSERT_TRUE(fifo.get(3, doc));
+        TEST_ASSERT_EQUAL_STRING("item5", doc["test"].as<const char*>());
+
+        TEST_ASSERT_TRUE(fifo.defragment());
+        TEST_ASSERT_EQUAL(0.0f, fifo.getFragmentationRatio());
+    }
+
+    MemoryList reopened("/test_binary.txt", indexedConfig());
+    TEST_ASSERT_EQUAL(6, reopened.size());
+    TEST_ASSERT_EQUAL_STRING(itemString(1).c_str(), reopened.get(0).c_str());
+    TEST_ASSERT_EQUAL_STRING(itemString(7).c_str(), reopened.getLast().c_str());
+}
+
+void test_binary_format_should_reject_corrupt_and_seal_torn_records(void) {
+    {
+        MemoryList fifo("/test_binary.txt", binaryConfig());
+        fifo.clear();
+        pushItems(fifo, 3);
+    }
+
+    // Damage a payload byte of record 1, then leave half a header behind like a reset would
+    const size_t recordLength = 9 + itemString(0).length();
+    File dataFile = SD.open("/test_binary.txt", "r+");
+    dataFile.seek(recordLength + 9 + 3);
+    dataFile.write('X');
+    dataFile.close();
+    dataFile = SD.open("/test_binary.txt", FILE_APPEND);
+    const uint8_t torn[] = {0xB0, 0x40, 0x00};
+    dataFile.write(torn, sizeof(torn));
+    dataFile.close();
+
+    MemoryList reopened("/test_binary.txt", binaryConfig());
+    TEST_ASSERT_EQUAL(3, reopened.size());
+    TEST_ASSERT_TRUE(reopened.get(1).isEmpty());
+    TEST_ASSERT_EQUAL_STRING(itemString(2).c_str(), reopened.get(2).c_str());
+
+    JsonDocument doc;
+    doc["test"] = "after";
+    TEST_ASSERT_TRUE(reopened.push(doc.as<JsonObjectConst>()));
+    TEST_ASSERT_EQUAL(4, reopened.calcSize());
+    TEST_ASSERT_EQUAL_STRING("{\"test\":\"after\"}", reopened.getLast().c_str());
+}
+
+void test_text_file_should_stay_readable_under_binary_config(void) {
+    {
+        MemoryList fifo("/test_binary.txt");
+        fifo.clear();
+        pushItems(fifo, 3);
+    }
+
+    MemoryList reopened("/test_binary.txt", binaryConfig());
+    pushItems(reopened, 1);
+    TEST_ASSERT_EQUAL('{', firstFileByte("/test_binary.txt"));
+    TEST_ASSERT_EQUAL(4, reopened.size());
+    TEST_ASSERT_EQUAL_STRING(itemString(2).c_str(), reopened.get(2).c_str());
+    TEST_ASSERT_EQUAL_STRING(itemString(0).c_str(), reopened.getLast().c_str());
+
+    // An emptied file takes the configured format
+    reopened.clear();
+    pushItems(reopened, 1);
+    TEST_ASSERT_EQUAL(0xB0, firstFileByte("/test_binary.txt") & 0xF0);
+}
+
+// MessagePack Tests
+MemoryListConfig packedConfig() {
+    MemoryListConfig config = ingestConfig(0);
+    config.encoding = RecordEncoding::MessagePack;
+    return config;
+}
+
+void enqueueItem(MemoryList& list, int i) {
+    JsonDocument doc;
+    doc["test"] = "item" + String(i);
+    TEST_ASSERT_TRUE(list.enqueue(doc.as<JsonObjectConst>()));
+}
+
+void test_msgpack_records_should_read_back_as_json(void) {
+    {
+        MemoryList fifo("/test_msgpack.txt", packedConfig());
+        fifo.clear();
+        pushItems(fifo, 4);
+        JsonDocument batch;
+        batch.add<JsonObject>()["test"] = "item4";
+        batch.add<JsonObject>()["test"] = "item5";
+        TEST_ASSERT_EQUAL(2, fifo.pushBatch(batch.as<JsonArrayConst>()));
+        enqueueItem(fifo, 6);
+        TEST_ASSERT_EQUAL(1, fifo.flush());
+        TEST_ASSERT_EQUAL(0xB1, firstFileByte("/test_msgpack.txt"));
+
+        TEST_ASSERT_EQUAL_STRING(itemString(1).c_str(), fifo.remove(1).c_str());
+        TEST_ASSERT_EQUAL(6, fifo.size());
+        TEST_ASSERT_EQUAL_STRING(itemString(5).c_str(), fifo.get(4).c_str());
+        TEST_ASSERT_EQUAL_STRING(itemString(6).c_str(), fifo.getLast().c_str());
+
+        char buffer[32];
+        TEST_ASSERT_EQUAL(itemString(2).length(), fifo.get(1, buffer, sizeof(buffer)));
+        TEST_ASSERT_EQUAL_STRING(itemString(2).c_str(), buffer);
+        // The payload fits, its JSON text does not
+        TEST_ASSERT_EQUAL(0, fifo.get(1, buffer, itemString(2).length()));
+        JsonDocument doc;
+        TEST_ASSERT_TRUE(fifo.get(2, doc));
+        TEST_ASSERT_EQUAL_STRING("item3", doc["test"].as<const char*>());
+
+        TEST_ASSERT_TRUE(fifo.defragment());
+    }
+
+    // Each record carries its encoding, so a JSON list reads them and appends JSON records
+    MemoryList reopened("/test_msgpack.txt", binaryConfig());
+    TEST_ASSERT_EQUAL(6, reopened.size());
+    pushItems(reopened, 1);
+    TEST_ASSERT_EQUAL_STRING(itemString(0).c_str(), reopened.get(0).c_str());
+    TEST_ASSERT_EQUAL_STRING(itemString(6).c_str(), reopened.get(5).c_str());
+    TEST_ASSERT_EQUAL_STRING(itemString(0).c_str(), reopened.getLast().c_str());
+    TEST_ASSERT_EQUAL(7, reopened.calcSize());
+}
+
+void test_msgpack_list_should_append_json_to_text_file(void) {
+    {
+        MemoryList fifo("/test_msgpack.txt");
+        fifo.clear();
+        pushItems(fifo, 2);
+    }
+
+    MemoryList reopened("/test_msgpack.txt", packedConfig());
+    pushItems(reopened, 1);
+    enqueueItem(reopened, 1);
+    TEST_ASSERT_EQUAL(1, reopened.flush());
+    TEST_ASSERT_EQUAL('{', firstFileByte("/test_msgpack.txt"));
+    TEST_ASSERT_EQUAL(4, reopened.calcSize());
+    TEST_ASSERT_EQUAL_STRING(itemString(0).c_str(), reopened.get(2).c_str());
+    TEST_ASSERT_EQUAL_STRING(itemString(1).c_str(), reopened.getLast().c_str());
+
+    // An emptied file switches to MessagePack records
+    reopened.clear();
+    pushItems(reopened, 1);
+    TEST_ASSERT_EQUAL(0xB1, firstFileByte("/test_msgpack.txt"));
+}
+
+// Write-Back Tests
+MemoryListConfig writeBackConfig(const uint32_t timeout) {
+    MemoryListConfig config = indexedConfig();
+    config.writeBackSize = 100;  // rounded up to one 512-byte sector
+    config.writeBackTimeout = timeout;
+    return config;
+}
+
+void test_write_back_should_hold_records_until_read_or_flush(void) {
+    MemoryList fifo("/test_writeback.txt", writeBackConfig(0));
+    fifo.clear();
+    pushItems(fifo, 3);
+    TEST_ASSERT_EQUAL(0, SD.open("/test_writeback.txt").size());
+    TEST_ASSERT_EQUAL(3, fifo.size());
+
+    // Reading a buffered record writes the buffer out first
+    TEST_ASSERT_EQUAL_STRING(itemString(2).c_str(), fifo.get(2).c_str());
+    const size_t written = SD.open("/test_writeback.txt").size();
+    TEST_ASSERT_EQUAL(3 * (itemString(0).length() + 2), written);
+
+    pushItems(fifo, 2);
+    TEST_ASSERT_EQUAL_STRING(itemString(0).c_str(), fifo.get(0).c_str());
+    TEST_ASSERT_EQUAL(written, SD.open("/test_writeback.txt").size());
+    TEST_ASSERT_EQUAL(2 * (itemString(0).length() + 2), fifo.getStats()["writeBackBytes"].as<size_t>());
+    TEST_ASSERT_EQUAL(2, fifo.flush());
+
+    MemoryList reopened("/test_writeback.txt", indexedConfig());
+    TEST_ASSERT_EQUAL(5, reopened.size());
+    TEST_ASSERT_EQUAL_STRING(itemString(1).c_str(), reopened.getLast().c_str());
+}
+
+void test_write_back_should_flush_when_full_or_timed_out(void) {
+    JsonDocument doc;
+    String pad;
+    for (int i = 0; i < 96; i++) pad += 'p';
+    doc["pad"] = pad;
+    const size_t length = measureJson(doc) + 2;
+    const size_t fit = 512 / length;
+    {
+        MemoryList fifo("/test_writeback.txt", writeBackConfig(0));
+        fifo.clear();
+        for (size_t i = 0; i < fit; i++) TEST_ASSERT_TRUE(fifo.push(doc.as<JsonObjectConst>()));
+        TEST_ASSERT_EQUAL(0, SD.open("/test_writeback.txt").size());
+        TEST_ASSERT_TRUE(fifo.push(doc.as<JsonObjectConst>()));
+        TEST_ASSERT_EQUAL(fit * length, SD.open("/test_writeback.txt").size());
+        TEST_ASSERT_EQUAL(fit + 1, fifo.size());
+    }
+    // The destructor writes the rest
+    TEST_ASSERT_EQUAL((fit + 1) * length, SD.open("/test_writeback.txt").size());
+
+    MemoryList timed("/test_writeback.txt", writeBackConfig(20));
+    timed.clear();
+    pushItems(timed, 1);
+    TEST_ASSERT_EQUAL(0, SD.open("/test_writeback.txt").size());
+    // The list's task writes it out once it has waited 20 ms
+    const unsigned long started = millis();
+    while (SD.open("/test_writeback.txt").size() == 0 && millis() - started < 5000) delay(5);
+    TEST_ASSERT_EQUAL(itemString(0).length() + 2, SD.open("/test_writeback.txt").size());
+    TEST_ASSERT_EQUAL(1, timed.size());
+}
+
+// Range Read Tests
+void test_forEach_should_stream_a_range_in_one_pass(void) {
+    MemoryListConfig config;
+    config.autoDefragment = false;
+    MemoryList fifo("/test_range.txt", config);
+    fifo.clear();
+    pushItems(fifo, 30);
+    fifo.remove(3);
+    fifo.remove(10);
+
+    JsonDocument before = fifo.getStats();
+    size_t expected = 5;
+    const size_t visited = fifo.forEach(5, 10, [&](const size_t index, const JsonDocument& doc) {
+        TEST_ASSERT_EQUAL(expected++, index);
+        String element;
+        serializeJson(doc, element);
+        TEST_ASSERT_EQUAL_STRING(itemString(index < 10 ? index + 1 : index + 2).c_str(), element.c_str());
+        return true;
+    });
+    TEST_ASSERT_EQUAL(10, visited);
+#ifdef MEMORY_LIST_IO_STATS
+    JsonDocument after = fifo.getStats();
+    TEST_ASSERT_EQUAL(1, statDelta(before, after, "opens"));
+#endif
+
+    // Returning false stops after that element, and the walk ends with the list
+    TEST_ASSERT_EQUAL(1, fifo.forEach(0, 10, [](size_t, const JsonDocument&) {return false;}));
+    TEST_ASSERT_EQUAL(3, fifo.forEach(25, 10, [](size_t, const JsonDocument&) {return true;}));
+    TEST_ASSERT_EQUAL(0, fifo.forEach(28, 10, [](size_t, const JsonDocument&) {return true;}));
+}
+
+void test_getFirst_should_return_records_longer_than_the_buffer(void) {
+    MemoryList fifo("/test_range.txt", binaryConfig());
+    fifo.clear();
+    pushItems(fifo, 2);
+    JsonDocument doc;
+    String large;
+    for (int i = 0; i < 600; i++) large += 'x';
+    doc["test"] = large;
+    fifo.push(doc.as<JsonObjectConst>());
+    pushItems(fifo, 1);
+
+    JsonDocument first = fifo.getFirst(10);
+    TEST_ASSERT_EQUAL(4, first.size());
+    TEST_ASSERT_EQUAL_STRING("item1", first[1]["test"].as<const char*>());
+    TEST_ASSERT_EQUAL(600, strlen(first[2]["test"].as<const char*>()));
+    TEST_ASSERT_EQUAL_STRING("item0", first[3]["test"].as<const char*>());
+}
+
+MemoryListConfig checkpointConfig() {
+    MemoryListConfig config = stateConfig();
+    config.checkpointInterval = 8;
+    config.autoDefragment = false;
+    return config;
+}
+
+void assertPage(const JsonDocument& page, const size_t offset, const size_t count) {
+    TEST_ASSERT_EQUAL(count, page.size());
+    for (size_t k = 0; k < count; k++) {
+        // Items 0-4 and 20 are removed below
+        const size_t index = offset + k;
+        String element;
+        serializeJson(page[k], element);
+        TEST_ASSERT_EQUAL_STRING(itemString(index < 15 ? index + 5 : index + 6).c_str(), element.c_str());
+    }
+}
+
+void test_getRange_should_page_from_checkpoints(void) {
+    {
+        MemoryList fifo("/test_range.txt", checkpointConfig());
+        fifo.clear();
+        pushItems(fifo, 100);
+        TEST_ASSERT_EQUAL(12, fifo.getStats()["checkpoints"].as<size_t>());
+
+        fifo.remove(20);
+        TEST_ASSERT_EQUAL(5, fifo.removeFirst(5));
+        assertPage(fifo.getRange(40, 10), 40, 10);
+        assertPage(fifo.getRange(3, 30), 3, 30);
+        assertPage(fifo.getRange(90, 10), 90, 4);
+        TEST_ASSERT_EQUAL(0, fifo.getRange(94, 1).size());
+
+        // Compaction moves every record, and every checkpoint along with it
+        TEST_ASSERT_TRUE(fifo.defragment());
+        assertPage(fifo.getRange(40, 10), 40, 10);
+        TEST_ASSERT_EQUAL(12, fifo.getStats()["checkpoints"].as<size_t>());
+    }
+    // Reopened from saved state, without the construction scan that fills the table
+    MemoryList reopened("/test_range.txt", checkpointConfig());
+    TEST_ASSERT_EQUAL(11, reopened.getStats()["checkpoints"].as<size_t>());
+    assertPage(reopened.getRange(77, 16), 77, 16);
+    assertPage(reopened.getFirst(8), 0, 8);
+}
+
+void test_checkpoint_budget_should_bound_the_table(void) {
+    MemoryListConfig config;
+    config.checkpointBudget = 120;
+    config.autoDefragment = false;
+    MemoryList fifo("/test_range.txt", config);
+    fifo.clear();
+    pushItems(fifo, 300);
+
+    // The stride doubles whenever the table fills, so it ends at a fixed size
+    JsonDocument stats = fifo.getStats();
+    TEST_ASSERT_LESS_OR_EQUAL(10, stats["checkpoints"].as<size_t>());
+    TEST_ASSERT_GREATER_OR_EQUAL(5, stats["checkpoints"].as<size_t>());
+    TEST_ASSERT_EQUAL(32, stats["checkpointInterval"].as<size_t>());
+
+    TEST_ASSERT_EQUAL_STRING(itemString(290).c_str(), fifo.get(290).c_str());
+#ifdef MEMORY_LIST_IO_STATS
+    // get() scans from the nearest checkpoint, not through 290 records from the head
+    JsonDocument before = fifo.getStats();
+    TEST_ASSERT_EQUAL_STRING(itemString(250).c_str(), fifo.readLine(250).c_str());
+    JsonDocument after = fifo.getStats();
+    TEST_ASSERT_LESS_THAN(32 * (itemString(250).length() + 2) + 1024, statDelta(before, after, "bytesRead"));
+#endif
+
+    // Removals repair the table in place
+    TEST_ASSERT_EQUAL_STRING(itemString(128).c_str(), fifo.remove(128).c_str());
+    TEST_ASSERT_EQUAL_STRING(itemString(129).c_str(), fifo.get(128).c_str());
+    TEST_ASSERT_EQUAL(70, fifo.removeFirst(70));
+    TEST_ASSERT_EQUAL_STRING(itemString(200).c_str(), fifo.get(129).c_str());
+    TEST_ASSERT_EQUAL_STRING(itemString(299).c_str(), fifo.get(228).c_str());
+    TEST_ASSERT_TRUE(fifo.defragment());
+    TEST_ASSERT_EQUAL_STRING(itemString(71).c_str(), fifo.get(1).c_str());
+    TEST_ASSERT_EQUAL_STRING(itemString(200).c_str(), fifo.get(129).c_str());
+}
+
+// Bulk Removal Tests
+void assertItemsWithout(MemoryList& fifo, const int total, const std::initializer_list<int> removed) {
+    size_t index = 0;
+    for (int item = 0; item < total; item++) {
+        if (std::find(removed.begin(), removed.end(), item) != removed.end()) continue;
+        TEST_ASSERT_EQUAL_STRING(itemString(item).c_str(), fifo.get(index++).c_str());
+    }
+    TEST_ASSERT_EQUAL(index, fifo.size());
+}
+
+void test_removeMany_should_remove_a_scattered_set(void) {
+    MemoryListConfig configs[] = {MemoryListConfig(), indexedConfig(), checkpointConfig(), binaryConfig()};
+    configs[2].checkpointInterval = 4;
+    for (const MemoryListConfig& config : configs) {
+        MemoryList fifo("/test_remove_many.txt", config);
+        fifo.clear();
+        pushItems(fifo, 40);
+
+        JsonDocument before = fifo.getStats();
+        const size_t indices[] = {30, 3, 17, 3, 0, 39, 99};
+        TEST_ASSERT_EQUAL(5, fifo.removeMany(indices));
+#ifdef MEMORY_LIST_IO_STATS
+        // One handle for the lookups and all five tombstones
+        JsonDocument after = fifo.getStats();
+        if (!config.useIndex && !config.persistState) {
+            TEST_ASSERT_EQUAL(1, statDelta(before, after, "opens"));
+            TEST_ASSERT_EQUAL(5, statDelta(before, after, "bytesWritten"));
+        }
+#endif
+        assertItemsWithout(fifo, 40, {0, 3, 17, 30, 39});
+        TEST_ASSERT_EQUAL_STRING(itemString(38).c_str(), fifo.getLast().c_str());
+
+        // Indices refer to the list before the call
+        const size_t more[] = {0, 1, 2};
+        TEST_ASSERT_EQUAL(3, fifo.removeMany(more));
+        assertItemsWithout(fifo, 40, {0, 1, 2, 3, 4, 17, 30, 39});
+        TEST_ASSERT_TRUE(fifo.defragment());
+        assertItemsWithout(fifo, 40, {0, 1, 2, 3, 4, 17, 30, 39});
+    }
+}
+
+void test_removeIf_should_remove_matches_in_one_pass(void) {
+    MemoryListConfig configs[] = {MemoryListConfig(), indexedConfig(), checkpointConfig(), binaryConfig()};
+    configs[2].checkpointInterval = 4;
+    for (const MemoryListConfig& config : configs) {
+        MemoryList fifo("/test_remove_if.txt", config);
+        fifo.clear();
+        pushItems(fifo, 40);
+
+        JsonDocument before = fifo.getStats();
+        size_t visited = 0;
+        TEST_ASSERT_EQUAL(14, fifo.removeIf([&](const JsonDocument& doc) {
+            visited++;
+            return String(doc["test"].as<const char*>()).substring(4).toInt() % 3 == 0;
+        }));
+        TEST_ASSERT_EQUAL(40, visited);
+#ifdef MEMORY_LIST_IO_STATS
+        // One handle for the walk and all fourteen tombstones
+        JsonDocument after = fifo.getStats();
+        if (!config.useIndex && !config.persistState) {
+            TEST_ASSERT_EQUAL(1, statDelta(before, after, "opens"));
+            TEST_ASSERT_EQUAL(14, statDelta(before, after, "bytesWritten"));
+        }
+#endif
+        assertItemsWithout(fifo, 40, {0, 3, 6, 9, 12, 15, 18, 21, 24, 27, 30, 33, 36, 39});
+        TEST_ASSERT_EQUAL_STRING(itemString(38).c_str(), fifo.getLast().c_str());
+
+        // The raw payload comes without its line ending
+        const String first = itemString(1);
+        const String last = itemString(38);
+        TEST_ASSERT_EQUAL(2, fifo.removeIf([&](const char* payload, const size_t length) {
+            return (length == first.length() && memcmp(payload, first.c_str(), length) == 0) ||
+                   (length == last.length() && memcmp(payload, last.c_str(), length) == 0);
+        }));
+        TEST_ASSERT_EQUAL(0, fifo.removeIf([](const JsonDocument&) {return false;}));
+        assertItemsWithout(fifo, 40, {0, 1, 3, 6, 9, 12, 15, 18, 21, 24, 27, 30, 33, 36, 38, 39});
+        TEST_ASSERT_EQUAL_STRING(itemString(37).c_str(), fifo.getLast().c_str());
+        TEST_ASSERT_TRUE(fifo.defragment());
+        assertItemsWithout(fifo, 40, {0, 1, 3, 6, 9, 12, 15, 18, 21, 24, 27, 30, 33, 36, 38, 39});
+    }
+}
+
+int RUN_UNITY_TESTS() {
     UNITY_BEGIN();
     
     // Basic Operations
@@ -208,13 +1349,86 @@ void RUN_UNITY_TESTS() {
     
     // Fragmentation Tests
     RUN_TEST(test_defragmentation_should_reduce_fragmentation);
+    RUN_TEST(test_fragmentation_counters_should_track_removals);
 
     RUN_TEST(test_getLast_split_across_buffers);
     RUN_TEST(test_getLast_multiple_newlines_at_boundary);
     RUN_TEST(test_getLast_multiple_tombstones);
     RUN_TEST(test_large_file_operations);
+
+    // Index Tests
+    RUN_TEST(test_index_get_should_return_element_at_index);
+    RUN_TEST(test_index_should_follow_remove_and_removeFirst);
+    RUN_TEST(test_index_should_be_rebuilt_when_corrupt);
+
+    // Session Mode Tests
+    RUN_TEST(test_session_should_persist_across_reopen);
+
+    // State Tests
+    RUN_TEST(test_state_should_survive_reopen);
+    RUN_TEST(test_state_should_be_ignored_when_corrupt);
+    RUN_TEST(test_state_should_be_rescanned_after_reset);
+
+    // Zero-Allocation Read Tests
+    RUN_TEST(test_get_into_buffer_should_not_allocate);
+    RUN_TEST(test_get_into_buffer_should_reject_small_buffer);
+    RUN_TEST(test_get_into_document_should_parse_element);
+
+    // Streaming Push Tests
+    RUN_TEST(test_push_should_stream_large_element);
+
+    // Batch Tests
+    RUN_TEST(test_pushBatch_should_append_all_elements);
+    RUN_TEST(test_removeFirst_should_cap_a_call_at_uint16_max);
+
+    // Construction Scan Tests
+    RUN_TEST(test_reopen_should_restore_derived_state);
+
+    // Tail Tests
+    RUN_TEST(test_getLast_should_follow_tail_changes);
+
+    // I/O Counter Tests
+    RUN_TEST(test_io_stats_should_count_hot_paths);
+
+    // Incremental Defragmentation Tests
+    RUN_TEST(test_defragmentStep_should_compact_incrementally);
+
+    // Background Compaction Tests
+    RUN_TEST(test_background_compaction_should_run_alongside_operations);
+
+    // Concurrency Tests
+    RUN_TEST(test_concurrent_writers_and_readers_should_not_corrupt);
+
+    // Ingest Ring Tests
+    RUN_TEST(test_enqueue_should_reach_file_in_order_per_producer);
+    RUN_TEST(test_enqueue_should_count_overflows);
+    RUN_TEST(test_enqueue_should_drain_a_small_ring_without_flush);
+    RUN_TEST(test_ingest_list_should_not_compact_when_opened);
+
+    // Binary Format Tests
+    RUN_TEST(test_binary_format_should_support_every_operation);
+    RUN_TEST(test_binary_format_should_reject_corrupt_and_seal_torn_records);
+    RUN_TEST(test_text_file_should_stay_readable_under_binary_config);
+
+    // MessagePack Tests
+    RUN_TEST(test_msgpack_records_should_read_back_as_json);
+    RUN_TEST(test_msgpack_list_should_append_json_to_text_file);
+
+    // Write-Back Tests
+    RUN_TEST(test_write_back_should_hold_records_until_read_or_flush);
+    RUN_TEST(test_write_back_should_flush_when_full_or_timed_out);
+
+    // Range Read Tests
+    RUN_TEST(test_forEach_should_stream_a_range_in_one_pass);
+    RUN_TEST(test_getFirst_should_return_records_longer_than_the_buffer);
+    RUN_TEST(test_getRange_should_page_from_checkpoints);
+    RUN_TEST(test_checkpoint_budget_should_bound_the_table);
+
+    // Bulk Removal Tests
+    RUN_TEST(test_removeMany_should_remove_a_scattered_set);
+    RUN_TEST(test_removeIf_should_remove_matches_in_one_pass);
     
-    UNITY_END();
+    return UNITY_END();
 }
 
 void setup() {
@@ -222,4 +1436,10 @@ void setup() {
     RUN_UNITY_TESTS();
 }
 
-void loop() {}
\ No newline at end of file
+void loop() {}
+
+#ifdef MEMORY_LIST_NATIVE
+int main() {
+    return RUN_UNITY_TESTS();
+}
+#endif